@@ -0,0 +1,116 @@
+// tomergal40@gmail.com
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace mycontainers {
+
+// Monotonic arena: allocations bump a pointer through a list of blocks and
+// are never freed individually. reset() makes every block reusable at once,
+// so a request that allocates only from the arena stops calling malloc once
+// the blocks have grown to its working set. Not thread-safe.
+class MonotonicArena {
+private:
+    struct Block {
+        std::unique_ptr<char[]> memory;
+        size_t size;
+    };
+
+    std::vector<Block> blocks;
+    size_t blockSize;
+    size_t current = 0;  // block being allocated from
+    size_t offset = 0;   // first free byte in blocks[current]
+    size_t used = 0;
+
+public:
+    explicit MonotonicArena(size_t initialBlockSize = 64 * 1024) : blockSize(initialBlockSize ? initialBlockSize : 1) {}
+
+    MonotonicArena(const MonotonicArena&) = delete;
+    MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+    void* allocate(size_t bytes, size_t alignment) {
+        for (; current < blocks.size(); ++current, offset = 0) {
+            void* start = blocks[current].memory.get() + offset;
+            size_t space = blocks[current].size - offset;
+            if (std::align(alignment, bytes, start, space)) {
+                offset = static_cast<size_t>(static_cast<char*>(start) - blocks[current].memory.get()) + bytes;
+                used += bytes;
+                return start;
+            }
+        }
+        // Blocks double in size, so a growing request needs few of them
+        size_t size = blocks.empty() ? blockSize : blocks.back().size * 2;
+        while (size < bytes + alignment) {
+            size *= 2;
+        }
+        blocks.push_back(Block{std::unique_ptr<char[]>(new char[size]), size});
+        offset = 0;
+        return allocate(bytes, alignment);
+    }
+
+    // Invalidates everything allocated so far but keeps the blocks
+    void reset() {
+        current = 0;
+        offset = 0;
+        used = 0;
+    }
+
+    // Bytes handed out since the last reset()
+    size_t bytesUsed() const {
+        return used;
+    }
+
+    size_t blockCount() const {
+        return blocks.size();
+    }
+};
+
+// Standard allocator drawing from a MonotonicArena; deallocate() is a no-op.
+// Containers using it must be destroyed before the arena is reset. The
+// allocator follows moved and swapped containers, so moving a container
+// never copies its elements.
+template<typename T>
+class ArenaAllocator {
+private:
+    template<typename U> friend class ArenaAllocator;
+
+    MonotonicArena* arena;
+
+public:
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    explicit ArenaAllocator(MonotonicArena& source) : arena(&source) {}
+
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t count) {
+        if (count > static_cast<size_t>(-1) / sizeof(T)) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(arena->allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, size_t) {}
+
+    template<typename U>
+    bool operator==(const ArenaAllocator<U>& other) const {
+        return arena == other.arena;
+    }
+
+    template<typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const {
+        return arena != other.arena;
+    }
+};
+
+} // namespace mycontainers
+
+#endif // ARENA_HPP
@@ -0,0 +1,323 @@
+// tomergal40@gmail.com
+#ifndef BINARYFORMAT_HPP
+#define BINARYFORMAT_HPP
+
+#include <cerrno>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MYCONTAINER_POSIX_SYNC 1
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#define MYCONTAINER_POSIX_SYNC 0
+#endif
+
+namespace mycontainers {
+namespace binary {
+
+// Container file layout, version 1: a 32-byte Header in the writer's byte
+// order, then the elements. Trivially copyable elements are stored as one
+// raw block; strings as a 64-bit length followed by their characters.
+struct Header {
+    char magic[8];
+    std::uint32_t version;
+    // byteOrderMark as the writer stored it; reads back swapped on a machine
+    // of the other endianness
+    std::uint32_t byteOrder;
+    std::uint32_t kind;
+    std::uint32_t elementSize;
+    std::uint64_t count;
+};
+
+static_assert(sizeof(Header) == 32, "Header must have no padding");
+
+const char magic[8] = {'M', 'Y', 'C', 'D', 'A', 'T', 'A', '1'};
+const std::uint32_t formatVersion = 1;
+const std::uint32_t byteOrderMark = 0x01020304;
+// Buffer of a container file being read or written
+const size_t bufferSize = size_t(1) << 20;
+
+// What the payload holds, so that a file is not read back as another type
+enum Kind : std::uint32_t { SignedInteger = 1, UnsignedInteger = 2, FloatingPoint = 3, Text = 4, Raw = 5 };
+
+// Encoding of T: the header tag and how elements are written and read
+template<typename T, typename Enable = void>
+struct Codec {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Only trivially copyable types and std::string can be serialized");
+};
+
+// File read or written through one large buffer. Small reads and writes are
+// a memcpy; blocks of at least bufferSize go straight to the file.
+class File {
+private:
+    std::FILE* stream;
+    std::unique_ptr<char[]> buffer;
+    // Unread bytes when reading, unwritten bytes when writing
+    size_t first = 0;
+    size_t last = 0;
+    std::string path;
+
+    void writeThrough(const void* bytes, size_t length) {
+        if (std::fwrite(bytes, 1, length, stream) != length) {
+            throw std::system_error(errno, std::generic_category(), "Cannot write " + path);
+        }
+    }
+
+    // Reads what is available, up to length bytes, and fails only on errors
+    size_t readSome(void* bytes, size_t length) {
+        size_t got = std::fread(bytes, 1, length, stream);
+        if (got != length && std::ferror(stream)) {
+            throw std::system_error(errno, std::generic_category(), "Cannot read " + path);
+        }
+        return got;
+    }
+
+    void flush() {
+        writeThrough(buffer.get(), last);
+        last = 0;
+    }
+
+public:
+    File(const std::string& name, const char* mode) : stream(std::fopen(name.c_str(), mode)), buffer(new char[bufferSize]), path(name) {
+        if (!stream) {
+            throw std::system_error(errno, std::generic_category(), "Cannot open " + path);
+        }
+        std::setvbuf(stream, nullptr, _IONBF, 0);
+    }
+
+    ~File() {
+        if (stream) {
+            std::fclose(stream);
+        }
+    }
+
+    File(const File&) = delete;
+    File& operator=(const File&) = delete;
+
+    void write(const void* bytes, size_t length) {
+        if (length == 0) {
+            return;
+        }
+        if (last + length > bufferSize) {
+            flush();
+        }
+        if (length >= bufferSize) {
+            writeThrough(bytes, length);
+            return;
+        }
+        std::memcpy(buffer.get() + last, bytes, length);
+        last += length;
+    }
+
+    void read(void* bytes, size_t length) {
+        if (length == 0) {
+            return;
+        }
+        char* out = static_cast<char*>(bytes);
+        size_t buffered = std::min(length, last - first);
+        std::memcpy(out, buffer.get() + first, buffered);
+        first += buffered;
+        out += buffered;
+        length -= buffered;
+        if (length >= bufferSize) {
+            if (readSome(out, length) != length) {
+                throw truncated();
+            }
+        } else if (length > 0) {
+            first = 0;
+            last = readSome(buffer.get(), bufferSize);
+            if (last < length) {
+                throw truncated();
+            }
+            std::memcpy(out, buffer.get(), length);
+            first = length;
+        }
+    }
+
+    // Bytes left to read; bounds the sizes a damaged header can ask for
+    size_t remaining() {
+        long here = std::ftell(stream);
+        if (here < 0 || std::fseek(stream, 0, SEEK_END) != 0) {
+            throw std::system_error(errno, std::generic_category(), "Cannot seek in " + path);
+        }
+        long end = std::ftell(stream);
+        std::fseek(stream, here, SEEK_SET);
+        return static_cast<size_t>(end - here) + (last - first);
+    }
+
+    // Flushes, syncs to disk and closes, reporting errors the destructor
+    // would swallow
+    void close() {
+        flush();
+#if MYCONTAINER_POSIX_SYNC
+        if (::fsync(fileno(stream)) != 0) {
+            throw std::system_error(errno, std::generic_category(), "Cannot sync " + path);
+        }
+#endif
+        std::FILE* closing = stream;
+        stream = nullptr;
+        if (std::fclose(closing) != 0) {
+            throw std::system_error(errno, std::generic_category(), "Cannot write " + path);
+        }
+    }
+
+    const std::string& name() const {
+        return path;
+    }
+
+    // Error for a file that ends early
+    std::runtime_error truncated() const {
+        return std::runtime_error("Truncated container file " + path);
+    }
+};
+
+template<typename T>
+struct Codec<T, typename std::enable_if<std::is_trivially_copyable<T>::value>::type> {
+    static const std::uint32_t kind = std::is_floating_point<T>::value ? FloatingPoint
+                                    : !std::is_integral<T>::value      ? Raw
+                                    : std::is_signed<T>::value         ? SignedInteger
+                                                                       : UnsignedInteger;
+    static const std::uint32_t elementSize = sizeof(T);
+
+    static void write(File& file, const T* elements, size_t count) {
+        file.write(elements, count * sizeof(T));
+    }
+
+    template<typename Alloc>
+    static void read(File& file, std::vector<T, Alloc>& elements, size_t count) {
+        if (count > file.remaining() / sizeof(T)) {
+            throw file.truncated();
+        }
+        size_t first = elements.size();
+        elements.resize(first + count);
+        file.read(elements.data() + first, count * sizeof(T));
+    }
+};
+
+template<>
+struct Codec<std::string> {
+    static const std::uint32_t kind = Text;
+    static const std::uint32_t elementSize = sizeof(char);
+
+    static void write(File& file, const std::string* elements, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            std::uint64_t length = elements[i].size();
+            file.write(&length, sizeof(length));
+            file.write(elements[i].data(), elements[i].size());
+        }
+    }
+
+    template<typename Alloc>
+    static void read(File& file, std::vector<std::string, Alloc>& elements, size_t count) {
+        size_t remaining = file.remaining();
+        // Every string takes at least its length field
+        if (count > remaining / sizeof(std::uint64_t)) {
+            throw file.truncated();
+        }
+        elements.reserve(elements.size() + count);
+        for (size_t i = 0; i < count; ++i) {
+            std::uint64_t length;
+            file.read(&length, sizeof(length));
+            remaining -= sizeof(length);
+            if (length > remaining) {
+                throw file.truncated();
+            }
+            std::string element(static_cast<size_t>(length), '\0');
+            file.read(&element[0], element.size());
+            remaining -= element.size();
+            elements.push_back(std::move(element));
+        }
+    }
+};
+
+// Makes a rename into the directory holding path durable
+inline void syncDirectory(const std::string& path) {
+#if MYCONTAINER_POSIX_SYNC
+    size_t slash = path.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int fd = ::open(directory.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "Cannot open " + directory);
+    }
+    int result = ::fsync(fd);
+    int error = errno;
+    ::close(fd);
+    if (result != 0) {
+        throw std::system_error(error, std::generic_category(), "Cannot sync " + directory);
+    }
+#else
+    (void)path;
+#endif
+}
+
+// Writes count elements to path through a temporary file that replaces path
+// only once complete and synced, so a failed save, or a crash during one,
+// leaves any previous file intact
+template<typename T>
+void save(const std::string& path, const T* elements, size_t count) {
+    std::string temporary = path + ".tmp";
+    try {
+        File file(temporary, "wb");
+        Header header;
+        std::memcpy(header.magic, magic, sizeof(magic));
+        header.version = formatVersion;
+        header.byteOrder = byteOrderMark;
+        header.kind = Codec<T>::kind;
+        header.elementSize = Codec<T>::elementSize;
+        header.count = count;
+        file.write(&header, sizeof(header));
+        Codec<T>::write(file, elements, count);
+        file.close();
+        if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+            throw std::system_error(errno, std::generic_category(), "Cannot replace " + path);
+        }
+    } catch (...) {
+        std::remove(temporary.c_str());
+        throw;
+    }
+    syncDirectory(path);
+}
+
+// Appends the elements stored in path to elements
+template<typename T, typename Alloc>
+void load(const std::string& path, std::vector<T, Alloc>& elements) {
+    File file(path, "rb");
+    Header header;
+    file.read(&header, sizeof(header));
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0) {
+        throw std::runtime_error("Not a container file: " + path);
+    }
+    if (header.byteOrder != byteOrderMark) {
+        throw std::runtime_error("Container file written with another byte order: " + path);
+    }
+    if (header.version != formatVersion) {
+        throw std::runtime_error("Unsupported container file version: " + path);
+    }
+    if (header.kind != Codec<T>::kind || header.elementSize != Codec<T>::elementSize) {
+        throw std::runtime_error("Container file holds another element type: " + path);
+    }
+    if (header.count > std::numeric_limits<size_t>::max()) {
+        throw std::runtime_error("Container file too large: " + path);
+    }
+    Codec<T>::read(file, elements, static_cast<size_t>(header.count));
+    if (file.remaining() != 0) {
+        throw std::runtime_error("Trailing data in container file " + path);
+    }
+}
+
+} // namespace binary
+} // namespace mycontainers
+
+#endif // BINARYFORMAT_HPP
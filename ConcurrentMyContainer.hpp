@@ -0,0 +1,299 @@
+// tomergal40@gmail.com
+#ifndef CONCURRENTMYCONTAINER_HPP
+#define CONCURRENTMYCONTAINER_HPP
+
+#include "MyContainer.hpp"
+#include <atomic>
+#include <mutex>
+#include <new>
+
+namespace mycontainers {
+
+// Thread-safe counterpart of MyContainer for concurrent ingest. Elements are
+// appended to one of several shards, each behind its own mutex; every thread
+// keeps to one shard, so with at least as many shards as threads the locks
+// are uncontended and add() shares no state with other threads. order()
+// lists the shards one after another, so elements added by one thread keep
+// their order, but elements from different threads are not interleaved by
+// the time they were added.
+//
+// remove(), size() and the traversal factories lock every shard, in a fixed
+// order, so they see a consistent cut of the container. The factories only
+// share each shard's buffer while the locks are held; the next add() to a
+// shared shard copies it first. The cut is materialized as a MyContainer
+// snapshot after the locks are released and is owned by the returned view,
+// which stays valid while adds and removes continue.
+template<typename T = int>
+class ConcurrentMyContainer {
+private:
+    typedef std::vector<T> Buffer;
+
+    // Aligned so that neighbouring shards' locks never share a cache line
+    struct alignas(64) Shard {
+        std::mutex lock;
+        // Null until the first add; shared with snapshots in progress
+        std::shared_ptr<Buffer> values;
+
+        // The buffer for modification; call with the lock held
+        Buffer& writable() {
+            if (!values) {
+                values = std::make_shared<Buffer>();
+            } else if (values.use_count() > 1) {
+                values = std::make_shared<Buffer>(*values);
+            } else {
+                // Orders the last reads of a released snapshot before our writes
+                std::atomic_thread_fence(std::memory_order_acquire);
+            }
+            return *values;
+        }
+    };
+
+    // Shards live in a block aligned by hand, as new ignores alignas before C++17
+    std::unique_ptr<char[]> shardMemory;
+    Shard* shards;
+    size_t shardCount;
+
+    // Small per-thread number handed out round-robin on first use
+    static size_t threadSlot() {
+        static std::atomic<size_t> nextSlot(0);
+        thread_local size_t slot = nextSlot++;
+        return slot;
+    }
+
+    Shard& localShard() {
+        return shards[threadSlot() % shardCount];
+    }
+
+    // Holds every shard lock, taken in index order so cuts never deadlock
+    class AllShards {
+    private:
+        const ConcurrentMyContainer& owner;
+
+    public:
+        explicit AllShards(const ConcurrentMyContainer& container) : owner(container) {
+            for (size_t i = 0; i < owner.shardCount; ++i) {
+                owner.shards[i].lock.lock();
+            }
+        }
+
+        ~AllShards() {
+            for (size_t i = owner.shardCount; i > 0; --i) {
+                owner.shards[i - 1].lock.unlock();
+            }
+        }
+
+        AllShards(const AllShards&) = delete;
+        AllShards& operator=(const AllShards&) = delete;
+    };
+
+    // Every shard's buffer, shared in one consistent cut; O(shards) under
+    // the locks
+    std::vector<std::shared_ptr<const Buffer> > cut() const {
+        std::vector<std::shared_ptr<const Buffer> > buffers(shardCount);
+        AllShards locked(*this);
+        for (size_t i = 0; i < shardCount; ++i) {
+            buffers[i] = shards[i].values;
+        }
+        return buffers;
+    }
+
+public:
+    // Traversal over a snapshot; keeps the snapshot alive as long as any copy
+    // of the view exists
+    template<typename View>
+    class SnapshotOrder {
+    private:
+        std::shared_ptr<const MyContainer<T> > snapshot;
+        View view;
+
+    public:
+        SnapshotOrder(std::shared_ptr<const MyContainer<T> > source, View order)
+            : snapshot(std::move(source)), view(std::move(order)) {}
+
+        SnapshotOrder& operator++() {
+            ++view;
+            return *this;
+        }
+
+        const T& operator*() const {
+            return *view;
+        }
+
+        bool operator!=(const SnapshotOrder& other) const {
+            return view != other.view;
+        }
+
+        bool operator==(const SnapshotOrder& other) const {
+            return view == other.view;
+        }
+
+        SnapshotOrder begin() const {
+            return SnapshotOrder(snapshot, view.begin());
+        }
+
+        SnapshotOrder end() const {
+            return SnapshotOrder(snapshot, view.end());
+        }
+    };
+
+    typedef SnapshotOrder<typename MyContainer<T>::AscendingOrder> AscendingOrder;
+    typedef SnapshotOrder<typename MyContainer<T>::DescendingOrder> DescendingOrder;
+    typedef SnapshotOrder<typename MyContainer<T>::SideCrossOrder> SideCrossOrder;
+    typedef SnapshotOrder<typename MyContainer<T>::ReverseOrder> ReverseOrder;
+    typedef SnapshotOrder<typename MyContainer<T>::Order> Order;
+    typedef SnapshotOrder<typename MyContainer<T>::MiddleOutOrder> MiddleOutOrder;
+
+    // 0 shards means one per hardware thread
+    explicit ConcurrentMyContainer(size_t shardsWanted = 0)
+        : shardCount(shardsWanted ? shardsWanted : std::max(1u, std::thread::hardware_concurrency())) {
+        size_t space = shardCount * sizeof(Shard) + alignof(Shard);
+        shardMemory.reset(new char[space]);
+        void* start = shardMemory.get();
+        std::align(alignof(Shard), shardCount * sizeof(Shard), start, space);
+        shards = static_cast<Shard*>(start);
+        for (size_t i = 0; i < shardCount; ++i) {
+            new (shards + i) Shard();
+        }
+    }
+
+    ~ConcurrentMyContainer() {
+        for (size_t i = 0; i < shardCount; ++i) {
+            shards[i].~Shard();
+        }
+    }
+
+    ConcurrentMyContainer(const ConcurrentMyContainer&) = delete;
+    ConcurrentMyContainer& operator=(const ConcurrentMyContainer&) = delete;
+
+    // Basic operations; all of them may be called from any thread
+    void add(const T& element) {
+        Shard& shard = localShard();
+        std::lock_guard<std::mutex> guard(shard.lock);
+        shard.writable().push_back(element);
+    }
+
+    void add(T&& element) {
+        Shard& shard = localShard();
+        std::lock_guard<std::mutex> guard(shard.lock);
+        shard.writable().push_back(std::move(element));
+    }
+
+    void remove(const T& element) {
+        // Remove ALL instances of the element
+        if (tryRemove(element) == 0) {
+            throw std::invalid_argument("Element not found in container");
+        }
+    }
+
+    size_t tryRemove(const T& element) {
+        AllShards locked(*this);
+        size_t removed = 0;
+        for (size_t i = 0; i < shardCount; ++i) {
+            const std::shared_ptr<Buffer>& values = shards[i].values;
+            // Shared buffers are only copied when something will be removed
+            if (values && std::find(values->begin(), values->end(), element) != values->end()) {
+                Buffer& buffer = shards[i].writable();
+                auto newEnd = std::remove(buffer.begin(), buffer.end(), element);
+                removed += static_cast<size_t>(buffer.end() - newEnd);
+                buffer.erase(newEnd, buffer.end());
+            }
+        }
+        return removed;
+    }
+
+    size_t size() const {
+        AllShards locked(*this);
+        size_t total = 0;
+        for (size_t i = 0; i < shardCount; ++i) {
+            total += shards[i].values ? shards[i].values->size() : 0;
+        }
+        return total;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    // Counts in a cut of the shards, after the locks are released
+    size_t count(const T& element) const {
+        size_t total = 0;
+        for (const std::shared_ptr<const Buffer>& values : cut()) {
+            if (values) {
+                total += static_cast<size_t>(std::count(values->begin(), values->end(), element));
+            }
+        }
+        return total;
+    }
+
+    bool contains(const T& element) const {
+        return count(element) != 0;
+    }
+
+    size_t getShardCount() const {
+        return shardCount;
+    }
+
+    // Consistent copy of the contents, shard after shard. The shards are
+    // shared under the locks and copied once after they are released.
+    MyContainer<T> snapshot() const {
+        std::vector<std::shared_ptr<const Buffer> > buffers = cut();
+        size_t total = 0;
+        for (const std::shared_ptr<const Buffer>& values : buffers) {
+            total += values ? values->size() : 0;
+        }
+        MyContainer<T> result;
+        result.reserve(total);
+        for (const std::shared_ptr<const Buffer>& values : buffers) {
+            if (values) {
+                result.addRange(values->begin(), values->end());
+            }
+        }
+        return result;
+    }
+
+    // Output operator; prints a snapshot
+    friend std::ostream& operator<<(std::ostream& os, const ConcurrentMyContainer& container) {
+        return os << container.snapshot();
+    }
+
+private:
+    std::shared_ptr<const MyContainer<T> > sharedSnapshot() const {
+        return std::make_shared<const MyContainer<T> >(snapshot());
+    }
+
+public:
+    // Iterator factory methods; each takes its own snapshot
+    AscendingOrder ascending() const {
+        std::shared_ptr<const MyContainer<T> > current = sharedSnapshot();
+        return AscendingOrder(current, current->ascending());
+    }
+
+    DescendingOrder descending() const {
+        std::shared_ptr<const MyContainer<T> > current = sharedSnapshot();
+        return DescendingOrder(current, current->descending());
+    }
+
+    SideCrossOrder sideCross() const {
+        std::shared_ptr<const MyContainer<T> > current = sharedSnapshot();
+        return SideCrossOrder(current, current->sideCross());
+    }
+
+    ReverseOrder reverse() const {
+        std::shared_ptr<const MyContainer<T> > current = sharedSnapshot();
+        return ReverseOrder(current, current->reverse());
+    }
+
+    Order order() const {
+        std::shared_ptr<const MyContainer<T> > current = sharedSnapshot();
+        return Order(current, current->order());
+    }
+
+    MiddleOutOrder middleOut() const {
+        std::shared_ptr<const MyContainer<T> > current = sharedSnapshot();
+        return MiddleOutOrder(current, current->middleOut());
+    }
+};
+
+} // namespace mycontainers
+
+#endif // CONCURRENTMYCONTAINER_HPP
@@ -0,0 +1,647 @@
+// tomergal40@gmail.com
+#ifndef MAPPEDMYCONTAINER_HPP
+#define MAPPEDMYCONTAINER_HPP
+
+#include "MyContainer.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <string>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mycontainers {
+
+namespace detail {
+
+// The error of the failed system call that set errno
+inline std::system_error systemFailure(const std::string& what, const std::string& file) {
+    return std::system_error(errno, std::generic_category(), what + " " + file);
+}
+
+// Sorted runs of a sequence, written back to back to an unlinked temporary
+// file, so the space is reclaimed even if the process dies. Each run is
+// stable-sorted, so equal elements keep their original order within it.
+template<typename T>
+class SortedRuns {
+private:
+    int fd;
+    // Run r holds elements [bounds[r], bounds[r + 1])
+    std::vector<size_t> bounds;
+
+public:
+    SortedRuns(const T* data, size_t count, size_t runLength, const std::string& directory) {
+        std::string pattern = directory + "mycontainer-sort-XXXXXX";
+        std::vector<char> name(pattern.begin(), pattern.end());
+        name.push_back('\0');
+        fd = ::mkstemp(name.data());
+        if (fd < 0) {
+            throw systemFailure("Cannot create sort file in", directory.empty() ? "." : directory);
+        }
+        ::unlink(name.data());
+        try {
+            std::vector<T> run;
+            run.reserve(std::min(count, runLength));
+            for (size_t first = 0; first < count; first += runLength) {
+                size_t length = std::min(runLength, count - first);
+                run.assign(data + first, data + first + length);
+                std::stable_sort(run.begin(), run.end());
+                write(run.data(), length, first);
+                bounds.push_back(first);
+            }
+            bounds.push_back(count);
+        } catch (...) {
+            ::close(fd);
+            throw;
+        }
+    }
+
+    ~SortedRuns() {
+        ::close(fd);
+    }
+
+    SortedRuns(const SortedRuns&) = delete;
+    SortedRuns& operator=(const SortedRuns&) = delete;
+
+    size_t runCount() const {
+        return bounds.size() - 1;
+    }
+
+    size_t runBegin(size_t run) const {
+        return bounds[run];
+    }
+
+    size_t runEnd(size_t run) const {
+        return bounds[run + 1];
+    }
+
+    void write(const T* values, size_t count, size_t offset) {
+        const char* bytes = reinterpret_cast<const char*>(values);
+        size_t remaining = count * sizeof(T);
+        off_t position = static_cast<off_t>(offset * sizeof(T));
+        while (remaining > 0) {
+            ssize_t written = ::pwrite(fd, bytes, remaining, position);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                throw systemFailure("Cannot write", "sort file");
+            }
+            bytes += written;
+            remaining -= static_cast<size_t>(written);
+            position += written;
+        }
+    }
+
+    void read(T* values, size_t count, size_t offset) const {
+        char* bytes = reinterpret_cast<char*>(values);
+        size_t remaining = count * sizeof(T);
+        off_t position = static_cast<off_t>(offset * sizeof(T));
+        while (remaining > 0) {
+            ssize_t got = ::pread(fd, bytes, remaining, position);
+            if (got <= 0) {
+                if (got < 0 && errno == EINTR) continue;
+                throw systemFailure("Cannot read", "sort file");
+            }
+            bytes += got;
+            remaining -= static_cast<size_t>(got);
+            position += got;
+        }
+    }
+};
+
+// Streams the k-way merge of SortedRuns, reading each run in blocks of
+// blockLength elements. Ascending merges break ties by run, so the result
+// is a stable sort; descending merges read every run backwards and yield
+// exactly the reverse.
+template<typename T>
+class RunMerger {
+private:
+    struct Cursor {
+        size_t low;          // unread part of the run in the file: [low, high)
+        size_t high;
+        std::vector<T> block;
+        size_t next;         // block elements still to be taken: [0, next) when
+        size_t available;    // descending, [next, available) when ascending
+    };
+
+    std::shared_ptr<const SortedRuns<T> > runs;
+    bool descending;
+    size_t blockLength;
+    std::vector<Cursor> cursors;
+    // Runs with elements left, as a heap whose top holds the next element
+    std::vector<size_t> heap;
+
+    const T& head(size_t run) const {
+        const Cursor& cursor = cursors[run];
+        return descending ? cursor.block[cursor.next - 1] : cursor.block[cursor.next];
+    }
+
+    // Whether run a's head comes before run b's head
+    bool before(size_t a, size_t b) const {
+        if (descending) {
+            if (head(b) < head(a)) return true;
+            if (head(a) < head(b)) return false;
+            return a > b;
+        }
+        if (head(a) < head(b)) return true;
+        if (head(b) < head(a)) return false;
+        return a < b;
+    }
+
+    struct Later {
+        const RunMerger* merger;
+
+        bool operator()(size_t a, size_t b) const {
+            return merger->before(b, a);
+        }
+    };
+
+    // Loads the next block of a run; false once the run is exhausted
+    bool refill(Cursor& cursor) {
+        size_t length = std::min(blockLength, cursor.high - cursor.low);
+        if (length == 0) {
+            return false;
+        }
+        cursor.block.resize(length);
+        if (descending) {
+            cursor.high -= length;
+            runs->read(cursor.block.data(), length, cursor.high);
+            cursor.next = length;
+        } else {
+            runs->read(cursor.block.data(), length, cursor.low);
+            cursor.low += length;
+            cursor.next = 0;
+        }
+        cursor.available = length;
+        return true;
+    }
+
+public:
+    RunMerger(std::shared_ptr<const SortedRuns<T> > sortedRuns, bool reverse, size_t block)
+        : runs(std::move(sortedRuns)), descending(reverse), blockLength(std::max<size_t>(block, 1)),
+          cursors(runs->runCount()) {
+        for (size_t r = 0; r < cursors.size(); ++r) {
+            cursors[r].low = runs->runBegin(r);
+            cursors[r].high = runs->runEnd(r);
+            if (refill(cursors[r])) {
+                heap.push_back(r);
+            }
+        }
+        std::make_heap(heap.begin(), heap.end(), Later{this});
+    }
+
+    RunMerger(const RunMerger&) = delete;
+    RunMerger& operator=(const RunMerger&) = delete;
+
+    bool done() const {
+        return heap.empty();
+    }
+
+    const T& current() const {
+        return head(heap.front());
+    }
+
+    void advance() {
+        std::pop_heap(heap.begin(), heap.end(), Later{this});
+        size_t run = heap.back();
+        Cursor& cursor = cursors[run];
+        bool more = descending ? --cursor.next > 0 : ++cursor.next < cursor.available;
+        if (more || refill(cursor)) {
+            std::push_heap(heap.begin(), heap.end(), Later{this});
+        } else {
+            heap.pop_back();
+        }
+    }
+};
+
+} // namespace detail
+
+// MyContainer variant whose elements live in a memory-mapped file, for data
+// sets larger than RAM. add(), remove() and the unsorted orders work on the
+// mapping directly and the page cache does the I/O. The element count is
+// kept in the file header and updated after each element is written, so
+// reopening the file (even after a crash) is O(1) and sees every completed
+// add(). The file grows by doubling. T must be trivially copyable, and the
+// file is only meaningful on machines with the same layout of T.
+//
+// The sorted orders sort a copy of the elements in memory while it fits the
+// sort memory budget. Larger containers are sorted externally: sorted runs
+// of budget size go to a temporary file next to the container file, and
+// the view streams their merge, so memory use stays within the budget.
+// sideCross() streams the merge from both ends at once.
+template<typename T>
+class MappedMyContainer {
+    static_assert(std::is_trivially_copyable<T>::value, "MappedMyContainer needs a trivially copyable T");
+    static_assert(alignof(T) <= 64, "MappedMyContainer places elements at a 64-byte offset");
+
+private:
+    // First 64 bytes of the file
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t elementSize;
+        std::uint64_t count;
+        std::uint64_t reserved[5];
+    };
+
+    static const char* magic() {
+        return "MYCMAP01";
+    }
+
+    static const std::uint32_t formatVersion = 1;
+    // Capacity of a new file, in elements
+    static const size_t initialCapacity = 1024;
+    // Default bound on the memory used by the sorted orders
+    static const size_t defaultSortBudget = size_t(256) << 20;
+    // Smallest block a merge reads from one run, in bytes
+    static const size_t minimumMergeBlock = 64 << 10;
+
+    std::string path;
+    int fd = -1;
+    void* mapping = nullptr;
+    size_t mappedBytes = 0;
+    size_t sortBudget = defaultSortBudget;
+
+    Header& header() const {
+        return *static_cast<Header*>(mapping);
+    }
+
+    T* elements() const {
+        return reinterpret_cast<T*>(static_cast<char*>(mapping) + sizeof(Header));
+    }
+
+    static size_t bytesFor(size_t elementCapacity) {
+        return sizeof(Header) + elementCapacity * sizeof(T);
+    }
+
+    void mapFile(size_t bytes) {
+        void* address = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (address == MAP_FAILED) {
+            throw detail::systemFailure("Cannot map", path);
+        }
+        mapping = address;
+        mappedBytes = bytes;
+    }
+
+    // Grows the file and the mapping to hold elementCapacity elements
+    void reserveFile(size_t elementCapacity) {
+        size_t bytes = bytesFor(elementCapacity);
+        if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+            throw detail::systemFailure("Cannot grow", path);
+        }
+#ifdef __linux__
+        void* address = ::mremap(mapping, mappedBytes, bytes, MREMAP_MAYMOVE);
+        if (address == MAP_FAILED) {
+            throw detail::systemFailure("Cannot remap", path);
+        }
+        mapping = address;
+        mappedBytes = bytes;
+#else
+        ::munmap(mapping, mappedBytes);
+        mapping = nullptr;
+        mapFile(bytes);
+#endif
+    }
+
+    void release() {
+        if (mapping) {
+            ::munmap(mapping, mappedBytes);
+            mapping = nullptr;
+        }
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+    // Sorted orders over a stably sorted copy of the elements, kept either in
+    // memory or as runs in a sort file. Copies of an iterator share its merge
+    // state, so like an input iterator only the latest copy may be advanced;
+    // begin() starts a new merge. A sideCross walk streams two merges, one
+    // from each end, and takes from them in turn.
+    template<detail::Walk walk>
+    class SortedView {
+    private:
+        std::shared_ptr<const std::vector<T> > sorted;
+        std::shared_ptr<const detail::SortedRuns<T> > runs;
+        size_t blockLength;
+        // The ascending merge, then the descending one
+        mutable std::shared_ptr<detail::RunMerger<T> > mergers[2];
+        size_t length;
+        size_t currentIndex;
+
+        // Whether the current step is taken from the largest end
+        bool fromTop() const {
+            if (walk == detail::Walk::Ascending) return false;
+            if (walk == detail::Walk::Descending) return true;
+            return currentIndex % 2 == 1;
+        }
+
+        detail::RunMerger<T>& stream() const {
+            bool descending = fromTop();
+            std::shared_ptr<detail::RunMerger<T> >& merger = mergers[descending ? 1 : 0];
+            if (!merger) {
+                merger = std::make_shared<detail::RunMerger<T> >(runs, descending, blockLength);
+            }
+            return *merger;
+        }
+
+        size_t rank() const {
+            if (walk == detail::Walk::Ascending) return currentIndex;
+            if (walk == detail::Walk::Descending) return length - 1 - currentIndex;
+            return detail::sideCrossRank(currentIndex, length);
+        }
+
+        SortedView restarted(size_t index) const {
+            SortedView iter(*this);
+            iter.mergers[0].reset();
+            iter.mergers[1].reset();
+            iter.currentIndex = index;
+            return iter;
+        }
+
+    public:
+        SortedView(std::shared_ptr<const std::vector<T> > inMemory, std::shared_ptr<const detail::SortedRuns<T> > onDisk,
+                   size_t block, size_t count)
+            : sorted(std::move(inMemory)), runs(std::move(onDisk)), blockLength(block), length(count), currentIndex(0) {}
+
+        SortedView& operator++() {
+            if (currentIndex < length) {
+                if (runs) {
+                    stream().advance();
+                }
+                currentIndex++;
+            }
+            return *this;
+        }
+
+        const T& operator*() const {
+            if (currentIndex >= length) {
+                throw std::out_of_range("Iterator out of range");
+            }
+            if (runs) {
+                return stream().current();
+            }
+            return (*sorted)[rank()];
+        }
+
+        bool operator!=(const SortedView& other) const {
+            return currentIndex != other.currentIndex;
+        }
+
+        bool operator==(const SortedView& other) const {
+            return currentIndex == other.currentIndex;
+        }
+
+        SortedView begin() const {
+            return restarted(0);
+        }
+
+        SortedView end() const {
+            return restarted(length);
+        }
+    };
+
+    template<detail::Walk walk>
+    SortedView<walk> sortedView() const {
+        size_t count = size();
+        size_t runLength = std::max<size_t>(sortBudget / sizeof(T), 1);
+        if (count <= runLength) {
+            std::shared_ptr<std::vector<T> > sorted = std::make_shared<std::vector<T> >(elements(), elements() + count);
+            std::stable_sort(sorted->begin(), sorted->end());
+            return SortedView<walk>(sorted, nullptr, 0, count);
+        }
+        size_t slash = path.find_last_of('/');
+        std::string directory = slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+        std::shared_ptr<const detail::SortedRuns<T> > runs =
+            std::make_shared<const detail::SortedRuns<T> >(elements(), count, runLength, directory);
+        // A sideCross walk splits the budget between its two merges
+        size_t streams = walk == detail::Walk::SideCross ? 2 : 1;
+        size_t block = std::max(sortBudget / (runs->runCount() * streams), minimumMergeBlock) / sizeof(T);
+        return SortedView<walk>(nullptr, runs, block, count);
+    }
+
+    typedef std::integral_constant<bool, simd::Supported<T>::value> Vectorized;
+
+    size_t keptAfterRemoving(const T& element, std::true_type) {
+        return simd::remove(elements(), size(), element);
+    }
+
+    size_t keptAfterRemoving(const T& element, std::false_type) {
+        return static_cast<size_t>(std::remove(elements(), elements() + size(), element) - elements());
+    }
+
+    size_t countInstances(const T& element, std::true_type) const {
+        return simd::count(elements(), size(), element);
+    }
+
+    size_t countInstances(const T& element, std::false_type) const {
+        return static_cast<size_t>(std::count(elements(), elements() + size(), element));
+    }
+
+public:
+    // Views over the mapping; like MyContainer's, they are invalidated by
+    // add() and remove()
+    typedef SortedView<detail::Walk::Ascending> AscendingOrder;
+    typedef SortedView<detail::Walk::Descending> DescendingOrder;
+    typedef SortedView<detail::Walk::SideCross> SideCrossOrder;
+    typedef detail::PlainView<T, detail::Walk::Reverse> ReverseOrder;
+    typedef detail::PlainView<T, detail::Walk::Order> Order;
+    typedef detail::PlainView<T, detail::Walk::MiddleOut> MiddleOutOrder;
+
+    // Opens the container stored at file, creating an empty one if the file
+    // does not exist. Throws std::system_error on I/O errors and
+    // std::runtime_error if the file holds something else.
+    explicit MappedMyContainer(const std::string& file) : path(file) {
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            throw detail::systemFailure("Cannot open", path);
+        }
+        try {
+            struct stat info;
+            if (::fstat(fd, &info) != 0) {
+                throw detail::systemFailure("Cannot stat", path);
+            }
+            size_t bytes = static_cast<size_t>(info.st_size);
+            if (bytes == 0) {
+                bytes = bytesFor(initialCapacity);
+                if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+                    throw detail::systemFailure("Cannot grow", path);
+                }
+                mapFile(bytes);
+                Header& fresh = header();
+                std::memcpy(fresh.magic, magic(), sizeof(fresh.magic));
+                fresh.version = formatVersion;
+                fresh.elementSize = static_cast<std::uint32_t>(sizeof(T));
+                fresh.count = 0;
+                return;
+            }
+            if (bytes < sizeof(Header)) {
+                throw std::runtime_error("Not a MappedMyContainer file: " + path);
+            }
+            mapFile(bytes);
+            const Header& existing = header();
+            if (std::memcmp(existing.magic, magic(), sizeof(existing.magic)) != 0 ||
+                existing.version != formatVersion) {
+                throw std::runtime_error("Not a MappedMyContainer file: " + path);
+            }
+            if (existing.elementSize != sizeof(T) || existing.count > capacity()) {
+                throw std::runtime_error("Element size or count mismatch in " + path);
+            }
+        } catch (...) {
+            release();
+            throw;
+        }
+    }
+
+    ~MappedMyContainer() {
+        release();
+    }
+
+    MappedMyContainer(const MappedMyContainer&) = delete;
+    MappedMyContainer& operator=(const MappedMyContainer&) = delete;
+
+    // A moved-from container may only be destroyed or assigned to
+    MappedMyContainer(MappedMyContainer&& other) noexcept
+        : path(std::move(other.path)), fd(other.fd), mapping(other.mapping), mappedBytes(other.mappedBytes),
+          sortBudget(other.sortBudget) {
+        other.fd = -1;
+        other.mapping = nullptr;
+        other.mappedBytes = 0;
+    }
+
+    MappedMyContainer& operator=(MappedMyContainer&& other) noexcept {
+        if (this != &other) {
+            release();
+            path = std::move(other.path);
+            fd = other.fd;
+            mapping = other.mapping;
+            mappedBytes = other.mappedBytes;
+            sortBudget = other.sortBudget;
+            other.fd = -1;
+            other.mapping = nullptr;
+            other.mappedBytes = 0;
+        }
+        return *this;
+    }
+
+    // Basic operations
+    void add(const T& element) {
+        size_t count = size();
+        if (count == capacity()) {
+            // Copied first: element may live in the mapping that is about to move
+            T value = element;
+            reserveFile(std::max(count * 2, initialCapacity));
+            elements()[count] = value;
+        } else {
+            elements()[count] = element;
+        }
+        header().count = count + 1;
+    }
+
+    void remove(const T& element) {
+        // Remove ALL instances of the element
+        if (tryRemove(element) == 0) {
+            throw std::invalid_argument("Element not found in container");
+        }
+    }
+
+    // Removes all instances of element by compacting the mapping in place
+    size_t tryRemove(const T& element) {
+        T value = element;
+        size_t count = size();
+        size_t kept = keptAfterRemoving(value, Vectorized());
+        header().count = kept;
+        return count - kept;
+    }
+
+    size_t size() const {
+        return static_cast<size_t>(header().count);
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    // Elements the file can hold before it has to grow
+    size_t capacity() const {
+        return (mappedBytes - sizeof(Header)) / sizeof(T);
+    }
+
+    bool contains(const T& element) const {
+        return count(element) != 0;
+    }
+
+    size_t count(const T& element) const {
+        return countInstances(element, Vectorized());
+    }
+
+    // Writes dirty pages back to the file; the kernel does so eventually
+    // anyway, this only makes it happen now
+    void flush() {
+        if (::msync(mapping, mappedBytes, MS_SYNC) != 0) {
+            throw detail::systemFailure("Cannot sync", path);
+        }
+    }
+
+    // Shrinks the file to the current size
+    void shrinkToFit() {
+        reserveFile(std::max<size_t>(size(), 1));
+    }
+
+    const std::string& getPath() const {
+        return path;
+    }
+
+    // Memory the sorted orders may use, in bytes; containers larger than
+    // this are sorted externally
+    void setSortMemoryBudget(size_t bytes) {
+        sortBudget = std::max(bytes, sizeof(T));
+    }
+
+    size_t getSortMemoryBudget() const {
+        return sortBudget;
+    }
+
+    // Output operator
+    friend std::ostream& operator<<(std::ostream& os, const MappedMyContainer& container) {
+        return text::writeSequence<T>(os, container.elements(), container.elements() + container.size());
+    }
+
+    // Iterator factory methods. The sorted orders sort a snapshot of the
+    // elements when called, so unlike the others they survive changes.
+    AscendingOrder ascending() const {
+        return sortedView<detail::Walk::Ascending>();
+    }
+
+    DescendingOrder descending() const {
+        return sortedView<detail::Walk::Descending>();
+    }
+
+    SideCrossOrder sideCross() const {
+        return sortedView<detail::Walk::SideCross>();
+    }
+
+    ReverseOrder reverse() const {
+        return ReverseOrder(elements(), size());
+    }
+
+    Order order() const {
+        return Order(elements(), size());
+    }
+
+    MiddleOutOrder middleOut() const {
+        return MiddleOutOrder(elements(), size());
+    }
+};
+
+template<typename T>
+const size_t MappedMyContainer<T>::initialCapacity;
+
+template<typename T>
+const size_t MappedMyContainer<T>::minimumMergeBlock;
+
+} // namespace mycontainers
+
+#endif // MAPPEDMYCONTAINER_HPP
@@ -7,79 +7,1127 @@
 #include <stdexcept>
 #include <iostream>
 #include <functional>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <iterator>
+#include <unordered_set>
+#include <initializer_list>
+#include <type_traits>
+#include <cstring>
+#include <thread>
+#include <exception>
+#include <atomic>
+#include <mutex>
+
+#include "SimdKernels.hpp"
+#include "BinaryFormat.hpp"
+#include "TextFormat.hpp"
+#include "OrderViews.hpp"
 
 namespace mycontainers {
 
-template<typename T = int>
+// Algorithms used to build the sorted index. Auto picks radix sort for
+// arithmetic element types once the input is large enough to pay for it
+// and small enough for its scratch space to stay under a fixed limit, and
+// comparison sort otherwise; Radix falls back to comparison sort for types
+// it cannot handle.
+enum class SortAlgorithm { Auto, Comparison, Radix };
+
+namespace detail {
+
+// Below this many elements comparison sort beats radix sort; the "sort"
+// benchmark suite puts the crossover near 1000 for int and double
+const size_t radixSortThreshold = 1024;
+// Auto stops picking radix sort once its scratch space, two key/position
+// entries per element, would pass this many bytes; comparison sort needs
+// none beyond the index itself
+const size_t radixSortMemoryLimit = size_t(256) << 20;
+
+// Unsigned radix key whose natural order matches operator< on T
+template<typename T, typename Enable = void>
+struct RadixKey {
+    static const bool supported = false;
+};
+
+template<typename T>
+struct RadixKey<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type> {
+    static const bool supported = true;
+    typedef typename std::make_unsigned<T>::type Key;
+
+    static Key get(T value) {
+        // Flipping the sign bit moves negative values below positive ones
+        const Key signBit = std::is_signed<T>::value ? static_cast<Key>(Key(1) << (sizeof(Key) * 8 - 1)) : Key(0);
+        return static_cast<Key>(static_cast<Key>(value) ^ signBit);
+    }
+};
+
+template<typename T>
+struct RadixKey<T, typename std::enable_if<std::is_floating_point<T>::value &&
+                                           (sizeof(T) == 4 || sizeof(T) == 8)>::type> {
+    static const bool supported = true;
+    typedef typename std::conditional<sizeof(T) == 4, std::uint32_t, std::uint64_t>::type Key;
+
+    static Key get(T value) {
+        // -0.0 == 0.0, so both must map to the same key
+        if (value == T(0)) {
+            value = T(0);
+        }
+        Key bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        // Negative values: flip all bits to reverse their order; positive
+        // values: set the sign bit to move them above the negatives
+        const Key signBit = static_cast<Key>(Key(1) << (sizeof(Key) * 8 - 1));
+        return (bits & signBit) ? static_cast<Key>(~bits) : static_cast<Key>(bits | signBit);
+    }
+};
+
+// Stable LSD radix sort of the positions in indices[0, count) by the keys
+// of their elements, one byte per pass. Passes where every element has the
+// same digit are skipped, so narrow value ranges cost fewer passes.
+// Scratch buffers come from allocator.
+template<typename T, typename Index>
+struct RadixEntry {
+    typename RadixKey<T>::Key key;
+    Index index;
+};
+
+template<typename T, typename Index, typename Alloc>
+typename std::enable_if<RadixKey<T>::supported, bool>::type
+radixSortIndices(const T* data, Index* indices, size_t count, const Alloc& allocator) {
+    typedef typename RadixKey<T>::Key Key;
+    typedef RadixEntry<T, Index> Entry;
+    typedef typename std::allocator_traits<Alloc>::template rebind_alloc<Entry> EntryAlloc;
+    typedef typename std::allocator_traits<Alloc>::template rebind_alloc<size_t> CountAlloc;
+    const size_t digits = sizeof(Key);
+
+    std::vector<Entry, EntryAlloc> entries(count, Entry(), EntryAlloc(allocator));
+    std::vector<Entry, EntryAlloc> scratch(count, Entry(), EntryAlloc(allocator));
+    std::vector<size_t, CountAlloc> histograms(digits * 256, 0, CountAlloc(allocator));
+    for (size_t i = 0; i < count; ++i) {
+        Key key = RadixKey<T>::get(data[indices[i]]);
+        entries[i].key = key;
+        entries[i].index = indices[i];
+        for (size_t d = 0; d < digits; ++d) {
+            histograms[d * 256 + ((key >> (d * 8)) & 0xff)]++;
+        }
+    }
+
+    for (size_t d = 0; d < digits && count > 0; ++d) {
+        size_t* histogram = &histograms[d * 256];
+        if (histogram[(entries[0].key >> (d * 8)) & 0xff] == count) {
+            continue;
+        }
+        size_t offset = 0;
+        for (size_t b = 0; b < 256; ++b) {
+            size_t bucket = histogram[b];
+            histogram[b] = offset;
+            offset += bucket;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            scratch[histogram[(entries[i].key >> (d * 8)) & 0xff]++] = entries[i];
+        }
+        entries.swap(scratch);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        indices[i] = entries[i].index;
+    }
+    return true;
+}
+
+template<typename T, typename Index, typename Alloc>
+typename std::enable_if<!RadixKey<T>::supported, bool>::type
+radixSortIndices(const T*, Index*, size_t, const Alloc&) {
+    return false;
+}
+
+// Whether Auto should radix sort count elements of T
+template<typename T, typename Index>
+typename std::enable_if<RadixKey<T>::supported, bool>::type
+radixSortPays(size_t count) {
+    return count >= radixSortThreshold && count <= radixSortMemoryLimit / (2 * sizeof(RadixEntry<T, Index>));
+}
+
+template<typename T, typename Index>
+typename std::enable_if<!RadixKey<T>::supported, bool>::type
+radixSortPays(size_t) {
+    return false;
+}
+
+// Inputs smaller than this are always sorted on the calling thread, since
+// starting threads would cost more than it saves
+const size_t parallelSortThreshold = size_t(1) << 17;
+// Smallest run handed to one sorting thread
+const size_t parallelSortChunk = size_t(1) << 15;
+
+// Runs every task, all but the first on their own thread, and rethrows the
+// first exception any of them raised once all have finished. Tasks whose
+// thread cannot be started run on the calling thread instead.
+inline void runParallel(std::vector<std::function<void()> >& tasks) {
+    std::vector<std::exception_ptr> errors(tasks.size());
+    auto run = [&tasks, &errors](size_t i) {
+        try {
+            tasks[i]();
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> threads;
+    size_t started = std::min<size_t>(tasks.size(), 1);
+    try {
+        threads.reserve(tasks.size());
+        for (; started < tasks.size(); ++started) {
+            threads.emplace_back(run, started);
+        }
+    } catch (...) {
+        // Out of threads or memory; the threads already running stay joinable
+    }
+    if (!tasks.empty()) {
+        run(0);
+    }
+    for (size_t i = started; i < tasks.size(); ++i) {
+        run(i);
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    for (const std::exception_ptr& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+} // namespace detail
+
+// Allocator supplies the element storage and every buffer the sorted
+// orders allocate (permutations, sort scratch space and their shared
+// control blocks), so an ArenaAllocator keeps traversals off the heap
+template<typename T = int, typename Allocator = std::allocator<T> >
 class MyContainer {
+public:
+    typedef Allocator allocator_type;
+    // Position type used by the index permutations of the sorted orders
+    typedef std::uint32_t Index;
+
+    // Hit/miss counters of the cached sorted index; merges counts the misses
+    // served by merging appended elements into the previous index
+    struct CacheStats {
+        size_t hits;
+        size_t misses;
+        size_t merges;
+    };
+
 private:
-    std::vector<T> data;
+    typedef std::vector<T, Allocator> Storage;
+    typedef typename std::allocator_traits<Allocator>::template rebind_alloc<Index> IndexAllocator;
+    typedef std::vector<Index, IndexAllocator> IndexVector;
+
+    // A sorted permutation together with the generation it was built for
+    struct SortCache {
+        std::shared_ptr<const IndexVector> indices;
+        unsigned long long generation;
+    };
+
+    // Orders positions by their elements; the greater form makes a min-heap
+    typedef detail::PositionLess<typename Storage::const_iterator> IndexLess;
+    typedef detail::PositionGreater<typename Storage::const_iterator> IndexGreater;
+
+    // Partially sorted permutation shared by every copy of a lazy view. The
+    // not yet ordered positions form a heap at the front; each extraction
+    // moves the next position of the order to the back, so step i lives at
+    // positions[size - 1 - i]. Reading k steps costs O(N + k log N).
+    // Extractions happen under lock; a step already ordered never moves
+    // again, so reading it only needs the published count.
+    template<typename Compare>
+    struct LazySelection {
+        // Extractions done at once when a step past the sorted part is read
+        static const size_t chunk = 64;
+
+        IndexVector positions;
+        size_t heapSize;
+        Compare comp;
+        std::atomic<size_t> ordered;
+        std::mutex lock;
+
+        LazySelection(IndexVector&& unordered, Compare order)
+            : positions(std::move(unordered)), heapSize(positions.size()), comp(order), ordered(0) {
+            std::make_heap(positions.begin(), positions.end(), comp);
+        }
+
+        // Wraps an already complete order, stored back to front
+        LazySelection(IndexVector&& complete, Compare order, size_t)
+            : positions(std::move(complete)), heapSize(0), comp(order), ordered(positions.size()) {}
+
+        Index at(size_t step) {
+            if (step >= ordered.load(std::memory_order_acquire)) {
+                std::lock_guard<std::mutex> guard(lock);
+                size_t target = std::min(positions.size(), step + chunk);
+                while (positions.size() - heapSize < target) {
+                    std::pop_heap(positions.begin(), positions.begin() + heapSize, comp);
+                    heapSize--;
+                }
+                ordered.store(positions.size() - heapSize, std::memory_order_release);
+            }
+            return positions[positions.size() - 1 - step];
+        }
+    };
+
+    // Value -> multiplicity map kept next to data when the membership index
+    // is enabled. It is type-erased so that T only needs std::hash and a
+    // default constructor in containers that actually enable it.
+    class MembershipIndex {
+    public:
+        virtual ~MembershipIndex() = default;
+        virtual MembershipIndex* clone() const = 0;
+        virtual void insert(const T& value) = 0;
+        // Forgets value entirely and returns how many instances it had
+        virtual size_t erase(const T& value) = 0;
+        virtual size_t count(const T& value) const = 0;
+    };
+
+    // Open-addressing table with linear probing and backward-shift deletion,
+    // so there are no tombstones and lookups of missing values stay short
+    class CountingHashIndex : public MembershipIndex {
+    private:
+        struct Slot {
+            T value;
+            size_t count;  // 0 marks an empty slot
+        };
+
+        std::vector<Slot> slots;
+        size_t used;
+        unsigned shift;
+
+        size_t home(const T& value) const {
+            // Fibonacci hashing spreads sequential std::hash values over the table
+            unsigned long long hash = static_cast<unsigned long long>(std::hash<T>()(value));
+            return static_cast<size_t>((hash * 11400714819323198485ull) >> shift);
+        }
+
+        size_t mask() const {
+            return slots.size() - 1;
+        }
+
+        // Slot holding value, or the empty slot where it would go
+        size_t find(const T& value) const {
+            size_t i = home(value);
+            while (slots[i].count != 0 && !(slots[i].value == value)) {
+                i = (i + 1) & mask();
+            }
+            return i;
+        }
+
+        void grow() {
+            std::vector<Slot> old(slots.size() * 2);
+            old.swap(slots);
+            shift--;
+            for (size_t i = 0; i < old.size(); ++i) {
+                if (old[i].count != 0) {
+                    slots[find(old[i].value)] = std::move(old[i]);
+                }
+            }
+        }
+
+    public:
+        CountingHashIndex() : slots(16), used(0), shift(60) {}
+
+        MembershipIndex* clone() const override {
+            return new CountingHashIndex(*this);
+        }
+
+        void insert(const T& value) override {
+            if ((used + 1) * 2 > slots.size()) {
+                grow();
+            }
+            Slot& slot = slots[find(value)];
+            if (slot.count == 0) {
+                slot.value = value;
+                used++;
+            }
+            slot.count++;
+        }
+
+        size_t erase(const T& value) override {
+            size_t hole = find(value);
+            size_t removed = slots[hole].count;
+            if (removed == 0) {
+                return 0;
+            }
+            // Pull back every later entry of the probe run that may not skip the hole
+            for (size_t next = (hole + 1) & mask(); slots[next].count != 0; next = (next + 1) & mask()) {
+                size_t distance = (next - home(slots[next].value)) & mask();
+                if (distance >= ((next - hole) & mask())) {
+                    slots[hole] = std::move(slots[next]);
+                    hole = next;
+                }
+            }
+            slots[hole].count = 0;
+            used--;
+            return removed;
+        }
+
+        size_t count(const T& value) const override {
+            return slots[find(value)].count;
+        }
+    };
+
+    // Owner of the membership index. Copying deep-copies it; snapshots share
+    // it, and writable() clones it before the first change while shared.
+    struct IndexHandle {
+        std::shared_ptr<MembershipIndex> index;
+
+        IndexHandle() = default;
+        IndexHandle(const IndexHandle& other) : index(other.index ? other.index->clone() : nullptr) {}
+        IndexHandle& operator=(const IndexHandle& other) {
+            index.reset(other.index ? other.index->clone() : nullptr);
+            return *this;
+        }
+        IndexHandle(IndexHandle&& other) = default;
+        IndexHandle& operator=(IndexHandle&& other) = default;
+
+        MembershipIndex* writable() {
+            if (index.use_count() > 1) {
+                index.reset(index->clone());
+            } else {
+                // Orders the last reads of a released snapshot before our writes
+                std::atomic_thread_fence(std::memory_order_acquire);
+            }
+            return index.get();
+        }
+    };
+
+    // The elements. A snapshot shares this buffer with the container; the
+    // first change after that copies it (see writable()), so the snapshot
+    // never sees the change. Null until the first change.
+    std::shared_ptr<Storage> storage;
+    // Stands in for the storage while there is none, so const members never
+    // allocate; it also carries the allocator
+    Storage noElements;
+
+    // Bumped by every modification; caches built for an older generation are stale
+    unsigned long long generation = 0;
+    // Generation right after the last remove(); only appends happened since
+    unsigned long long removalGeneration = 0;
+
+    // The ascending permutation backs all three sorted orders. It is built on
+    // first use and reused until data changes. cacheLock guards it and the
+    // stats, so const readers may build it concurrently, as at baseline.
+    mutable SortCache ascendingCache = SortCache();
+    mutable CacheStats stats = CacheStats();
+    mutable std::mutex cacheLock;
+
+    // When set, elements appended since the last sort are sorted on their own
+    // and merged into the stale index instead of resorting everything
+    bool incrementalSort = false;
+
+    SortAlgorithm sortAlgorithm = SortAlgorithm::Auto;
+    // Threads for sorting large containers; 0 uses every hardware thread
+    unsigned sortThreads = 0;
+
+    // When set, copies share the storage and indexes like snapshots do
+    bool copyOnWrite = false;
+
+    // Optional value -> count index answering contains()/count() in O(1)
+    IndexHandle membership;
+
+    const Storage& data() const {
+        return storage ? *storage : noElements;
+    }
+
+    template<typename View>
+    static std::ostream& printView(std::ostream& os, const View& view) {
+        return text::writeSequence<T>(os, view.begin(), view.end());
+    }
+
+    bool isShared() const {
+        return storage.use_count() > 1;
+    }
+
+    // A new storage buffer holding a copy of elements, using our allocator
+    std::shared_ptr<Storage> copyOf(const Storage& elements) const {
+        Allocator allocator = noElements.get_allocator();
+        return std::allocate_shared<Storage>(allocator, elements.begin(), elements.end(), allocator);
+    }
+
+    // The storage for modification, copied first if a snapshot shares it
+    Storage& writable() {
+        if (!storage) {
+            storage = std::allocate_shared<Storage>(noElements.get_allocator(), noElements.get_allocator());
+        } else if (isShared()) {
+            storage = copyOf(*storage);
+        } else {
+            // Orders the last reads of a released snapshot before our writes
+            std::atomic_thread_fence(std::memory_order_acquire);
+        }
+        return *storage;
+    }
+
+    // Records that count elements were appended to the storage
+    void appended(size_t count) {
+        if (count == 0) {
+            return;
+        }
+        generation++;
+        if (membership.index) {
+            MembershipIndex* index = membership.writable();
+            const Storage& elements = data();
+            for (size_t i = elements.size() - count; i < elements.size(); ++i) {
+                index->insert(elements[i]);
+            }
+        }
+    }
+
+    // Copies every member, sharing the storage and indexes when share is set
+    void copyState(const MyContainer& other, bool share) {
+        if (share) {
+            storage = other.storage;
+            membership.index = other.membership.index;
+        } else {
+            storage = other.storage ? copyOf(*other.storage) : nullptr;
+            membership = other.membership;
+        }
+        generation = other.generation;
+        removalGeneration = other.removalGeneration;
+        {
+            std::lock_guard<std::mutex> guard(other.cacheLock);
+            ascendingCache = other.ascendingCache;
+            stats = other.stats;
+        }
+        incrementalSort = other.incrementalSort;
+        sortAlgorithm = other.sortAlgorithm;
+        sortThreads = other.sortThreads;
+        copyOnWrite = other.copyOnWrite;
+    }
+
+    // Swaps everything but the elements
+    void swapState(MyContainer& other) noexcept {
+        using std::swap;
+        swap(generation, other.generation);
+        swap(removalGeneration, other.removalGeneration);
+        swap(ascendingCache, other.ascendingCache);
+        swap(stats, other.stats);
+        swap(incrementalSort, other.incrementalSort);
+        swap(sortAlgorithm, other.sortAlgorithm);
+        swap(sortThreads, other.sortThreads);
+        swap(copyOnWrite, other.copyOnWrite);
+        swap(membership, other.membership);
+    }
+
+    static void checkIndexable(size_t count) {
+        if (count > static_cast<size_t>(std::numeric_limits<Index>::max())) {
+            throw std::length_error("Container too large for index permutation");
+        }
+    }
+
+    // Sorts the positions in [begin, begin + count) on the calling thread
+    // with algorithm, which is never Auto here. Radix sort is stable, so on
+    // positions that start out in order it yields the same permutation as
+    // IndexLess. Scratch space comes from scratchAllocator.
+    template<typename ScratchAllocator>
+    static void sortPositions(const Storage& data, Index* begin, size_t count, SortAlgorithm algorithm,
+                              const ScratchAllocator& scratchAllocator) {
+        bool sorted = false;
+        if (algorithm == SortAlgorithm::Radix) {
+            sorted = detail::radixSortIndices(data.data(), begin, count, scratchAllocator);
+        }
+        if (!sorted) {
+            std::sort(begin, begin + count, IndexLess{data.cbegin()});
+        }
+    }
+
+    // Threads used to sort count positions when threads were requested (0
+    // meaning one per hardware thread)
+    static unsigned sortWorkers(size_t count, unsigned threads) {
+        if (count < detail::parallelSortThreshold) {
+            return 1;
+        }
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        return static_cast<unsigned>(std::min<size_t>(threads, count / detail::parallelSortChunk));
+    }
+
+    // Positions [first, last) of data in ascending order. Large inputs are
+    // split into one run per thread, sorted concurrently and merged pairwise;
+    // IndexLess is a strict total order, so the result is identical to the
+    // serial one regardless of the thread count. Sorting threads take their
+    // scratch space from the default heap, since allocators such as
+    // ArenaAllocator are not thread-safe.
+    static IndexVector sortedIndices(const Storage& data, size_t first, size_t last,
+                                     SortAlgorithm algorithm = SortAlgorithm::Auto,
+                                     unsigned threads = 1) {
+        checkIndexable(last);
+        size_t count = last - first;
+        IndexVector indices(count, Index(), IndexAllocator(data.get_allocator()));
+        for (size_t i = 0; i < count; ++i) {
+            indices[i] = static_cast<Index>(first + i);
+        }
+        // Decided on the whole input, since parallel runs need scratch at once
+        if (algorithm == SortAlgorithm::Auto) {
+            algorithm = detail::radixSortPays<T, Index>(count) ? SortAlgorithm::Radix : SortAlgorithm::Comparison;
+        }
+
+        unsigned workers = sortWorkers(count, threads);
+        if (workers <= 1) {
+            sortPositions(data, indices.data(), count, algorithm, data.get_allocator());
+            return indices;
+        }
+
+        std::vector<size_t> bounds(workers + 1);
+        for (unsigned w = 0; w <= workers; ++w) {
+            bounds[w] = count * w / workers;
+        }
+        std::vector<std::function<void()> > tasks;
+        for (unsigned w = 0; w < workers; ++w) {
+            Index* run = indices.data() + bounds[w];
+            size_t runLength = bounds[w + 1] - bounds[w];
+            tasks.push_back([&data, run, runLength, algorithm]() {
+                sortPositions(data, run, runLength, algorithm, std::allocator<T>());
+            });
+        }
+        detail::runParallel(tasks);
+
+        IndexVector scratch(count, Index(), indices.get_allocator());
+        Index* from = indices.data();
+        Index* to = scratch.data();
+        for (unsigned width = 1; width < workers; width *= 2) {
+            tasks.clear();
+            for (unsigned w = 0; w < workers; w += 2 * width) {
+                size_t low = bounds[w];
+                size_t middle = bounds[std::min(w + width, workers)];
+                size_t high = bounds[std::min(w + 2 * width, workers)];
+                tasks.push_back([&data, from, to, low, middle, high]() {
+                    std::merge(from + low, from + middle, from + middle, from + high, to + low, IndexLess{data.cbegin()});
+                });
+            }
+            detail::runParallel(tasks);
+            std::swap(from, to);
+        }
+        if (from != indices.data()) {
+            indices.swap(scratch);
+        }
+        return indices;
+    }
+
+    static IndexVector sortedIndices(const Storage& data,
+                                     SortAlgorithm algorithm = SortAlgorithm::Auto,
+                                     unsigned threads = 1) {
+        return sortedIndices(data, 0, data.size(), algorithm, threads);
+    }
+
+    static IndexVector identityIndices(const Storage& data) {
+        size_t count = data.size();
+        checkIndexable(count);
+        IndexVector indices(count, Index(), IndexAllocator(data.get_allocator()));
+        for (size_t i = 0; i < count; ++i) {
+            indices[i] = static_cast<Index>(i);
+        }
+        return indices;
+    }
+
+    // Moves a finished permutation into the immutable buffer shared by
+    // every copy of a view, so begin()/end() never copy it again
+    static std::shared_ptr<const IndexVector> sharedIndices(IndexVector&& indices) {
+        IndexAllocator allocator = indices.get_allocator();
+        return std::allocate_shared<const IndexVector>(allocator, std::move(indices));
+    }
+
+    // Sorts only the appended tail and merges it with the previous index:
+    // O(N + k log k) for k new elements
+    IndexVector mergedIndices(const IndexVector& sorted) const {
+        const Storage& elements = data();
+        IndexVector delta = sortedIndices(elements, sorted.size(), elements.size(), sortAlgorithm, sortThreads);
+        IndexVector merged(sorted.get_allocator());
+        merged.reserve(elements.size());
+        std::merge(sorted.begin(), sorted.end(), delta.begin(), delta.end(),
+                   std::back_inserter(merged), IndexLess{elements.cbegin()});
+        return merged;
+    }
+
+    // The cached ascending index if it is current, without touching the stats
+    std::shared_ptr<const IndexVector> currentAscendingIndices() const {
+        std::lock_guard<std::mutex> guard(cacheLock);
+        if (ascendingCache.indices && ascendingCache.generation == generation) {
+            return ascendingCache.indices;
+        }
+        return std::shared_ptr<const IndexVector>();
+    }
+
+    // Whether SimdKernels has vector search and compaction for T
+    typedef std::integral_constant<bool, simd::Supported<T>::value> Vectorized;
+
+    static const size_t unknownCount = static_cast<size_t>(-1);
+
+    // Compacts away every instance of element and returns the new end
+    typename Storage::iterator withoutInstances(const T& element, size_t, std::true_type) {
+        Storage& elements = writable();
+        return elements.begin() + static_cast<std::ptrdiff_t>(simd::remove(elements.data(), elements.size(), element));
+    }
+
+    // When the number of instances is known, comparisons stop at the last
+    // one and the rest is shifted without compares
+    typename Storage::iterator withoutInstances(const T& element, size_t instances, std::false_type) {
+        Storage& elements = writable();
+        if (instances == unknownCount) {
+            return std::remove(elements.begin(), elements.end(), element);
+        }
+        auto out = std::find(elements.begin(), elements.end(), element);
+        auto in = out;
+        for (size_t found = 0; found < instances; ++in) {
+            if (*in == element) {
+                found++;
+            } else {
+                *out++ = std::move(*in);
+            }
+        }
+        return std::move(in, elements.end(), out);
+    }
+
+    size_t findInstance(const T& element, std::true_type) const {
+        return simd::find(data().data(), data().size(), element);
+    }
+
+    size_t findInstance(const T& element, std::false_type) const {
+        return static_cast<size_t>(std::find(data().begin(), data().end(), element) - data().begin());
+    }
+
+    size_t countInstances(const T& element, std::true_type) const {
+        return simd::count(data().data(), data().size(), element);
+    }
+
+    size_t countInstances(const T& element, std::false_type) const {
+        return static_cast<size_t>(std::count(data().begin(), data().end(), element));
+    }
+
+    // Drops [newEnd, end) after a compacting pass over the writable storage;
+    // returns the number dropped
+    size_t eraseTail(typename Storage::iterator newEnd) {
+        Storage& elements = *storage;
+        size_t removed = static_cast<size_t>(elements.end() - newEnd);
+        if (removed > 0) {
+            elements.erase(newEnd, elements.end());
+            generation++;
+            removalGeneration = generation;
+        }
+        return removed;
+    }
+
+    std::shared_ptr<const IndexVector> ascendingIndices() const {
+        std::lock_guard<std::mutex> guard(cacheLock);
+        if (ascendingCache.indices && ascendingCache.generation == generation) {
+            stats.hits++;
+            return ascendingCache.indices;
+        }
+        stats.misses++;
+        if (incrementalSort && ascendingCache.indices && ascendingCache.generation >= removalGeneration) {
+            stats.merges++;
+            ascendingCache.indices = sharedIndices(mergedIndices(*ascendingCache.indices));
+        } else {
+            ascendingCache.indices = sharedIndices(sortedIndices(data(), sortAlgorithm, sortThreads));
+        }
+        ascendingCache.generation = generation;
+        return ascendingCache.indices;
+    }
 
 public:
     // Constructors and destructor
     MyContainer() = default;
-    MyContainer(const MyContainer& other) = default;
-    MyContainer& operator=(const MyContainer& other) = default;
+    explicit MyContainer(const Allocator& allocator) : noElements(allocator) {}
+
+    MyContainer(const MyContainer& other)
+        : noElements(std::allocator_traits<Allocator>::select_on_container_copy_construction(other.noElements.get_allocator())) {
+        copyState(other, other.copyOnWrite && noElements.get_allocator() == other.noElements.get_allocator());
+    }
+
+    // Keeps this container's allocator, as std::vector does
+    MyContainer& operator=(const MyContainer& other) {
+        if (this != &other) {
+            MyContainer copy(noElements.get_allocator());
+            copy.copyState(other, other.copyOnWrite && noElements.get_allocator() == other.noElements.get_allocator());
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
     ~MyContainer() = default;
 
+    // The moved-from container is left empty with default settings
+    MyContainer(MyContainer&& other) noexcept
+        : storage(std::move(other.storage)), noElements(other.noElements.get_allocator()) {
+        swapState(other);
+    }
+
+    // Elements are moved one by one only when the allocators differ and do
+    // not propagate, as with std::vector
+    MyContainer& operator=(MyContainer&& other)
+        noexcept(std::allocator_traits<Allocator>::propagate_on_container_move_assignment::value) {
+        if (this != &other) {
+            MyContainer moved(std::move(other));
+            if (std::allocator_traits<Allocator>::propagate_on_container_move_assignment::value ||
+                noElements.get_allocator() == moved.noElements.get_allocator()) {
+                noElements = std::move(moved.noElements);
+                storage = std::move(moved.storage);
+            } else {
+                storage.reset();
+                if (moved.storage && moved.isShared()) {
+                    writable() = *moved.storage;
+                } else if (moved.storage) {
+                    writable() = std::move(*moved.storage);
+                }
+            }
+            swapState(moved);
+        }
+        return *this;
+    }
+
+    // Immutable version of the current contents in O(1): the snapshot shares
+    // the storage, sorted index and membership index with this container,
+    // and the next add()/remove() here copies the storage instead of changing
+    // it. Taking a snapshot must be synchronized with writers like any other
+    // call, but the snapshot can then be traversed on another thread while
+    // this container keeps changing.
+    MyContainer snapshot() const {
+        MyContainer result(noElements.get_allocator());
+        result.copyState(*this, true);
+        return result;
+    }
+
     // Basic operations
     void add(const T& element) {
-        data.push_back(element);
+        writable().push_back(element);
+        appended(1);
+    }
+
+    void add(T&& element) {
+        writable().push_back(std::move(element));
+        appended(1);
+    }
+
+    // Constructs the element in place from args
+    template<typename... Args>
+    void emplace(Args&&... args) {
+        writable().emplace_back(std::forward<Args>(args)...);
+        appended(1);
+    }
+
+    // Appends [first, last) with a single reservation for forward iterators;
+    // pass move iterators to move the elements in
+    template<typename InputIt>
+    void addRange(InputIt first, InputIt last) {
+        Storage& elements = writable();
+        size_t before = elements.size();
+        elements.insert(elements.end(), first, last);
+        appended(elements.size() - before);
+    }
+
+    void add(std::initializer_list<T> elements) {
+        addRange(elements.begin(), elements.end());
+    }
+
+    // Makes room for capacity elements, so that adds up to there do not
+    // reallocate the storage
+    void reserve(size_t capacity) {
+        writable().reserve(capacity);
     }
 
     void remove(const T& element) {
-        auto it = std::find(data.begin(), data.end(), element);
-        if (it == data.end()) {
+        // Remove ALL instances of the element
+        if (tryRemove(element) == 0) {
             throw std::invalid_argument("Element not found in container");
         }
-        // Remove ALL instances of the element
-        data.erase(std::remove(data.begin(), data.end(), element), data.end());
+    }
+
+    // Removes all instances of element in a single pass and returns how many
+    // were removed; a missing element is not an error
+    size_t tryRemove(const T& element) {
+        if (!membership.index) {
+            // Shared storage is only copied when something will be removed
+            if (isShared() && !contains(element)) {
+                return 0;
+            }
+            return eraseTail(withoutInstances(element, unknownCount, Vectorized()));
+        }
+        // The index knows how many instances exist, so a miss costs O(1)
+        if (membership.index->count(element) == 0) {
+            return 0;
+        }
+        size_t expected = membership.writable()->erase(element);
+        if (expected == 0) {
+            return 0;
+        }
+        return eraseTail(withoutInstances(element, expected, Vectorized()));
+    }
+
+    // Removes every element equal to any of the given values in one sweep,
+    // O(N + M) instead of one pass per value. Requires std::hash<T>.
+    template<typename InputIt>
+    size_t removeAny(InputIt first, InputIt last) {
+        std::unordered_set<T> values(first, last);
+        auto listed = [&values](const T& element) {
+            return values.count(element) != 0;
+        };
+        if (values.empty() || (isShared() && std::none_of(data().begin(), data().end(), listed))) {
+            return 0;
+        }
+        Storage& elements = writable();
+        auto newEnd = std::remove_if(elements.begin(), elements.end(), listed);
+        if (membership.index) {
+            MembershipIndex* index = membership.writable();
+            for (const T& value : values) {
+                index->erase(value);
+            }
+        }
+        return eraseTail(newEnd);
+    }
+
+    template<typename Range>
+    size_t removeAny(const Range& values) {
+        return removeAny(std::begin(values), std::end(values));
+    }
+
+    size_t removeAny(std::initializer_list<T> values) {
+        return removeAny(values.begin(), values.end());
     }
 
     size_t size() const {
-        return data.size();
+        return data().size();
+    }
+
+    Allocator getAllocator() const {
+        return noElements.get_allocator();
     }
 
     bool empty() const {
-        return data.empty();
+        return data().empty();
+    }
+
+    // O(1) with the membership index, a linear scan without it
+    bool contains(const T& element) const {
+        if (membership.index) {
+            return membership.index->count(element) != 0;
+        }
+        return findInstance(element, Vectorized()) != data().size();
+    }
+
+    size_t count(const T& element) const {
+        if (membership.index) {
+            return membership.index->count(element);
+        }
+        return countInstances(element, Vectorized());
+    }
+
+    // Maintains a hash index from value to multiplicity across add()/remove(),
+    // making contains(), count() and misses in remove() O(1). Enabling it
+    // indexes the current contents; T must support std::hash.
+    void setMembershipIndex(bool enabled) {
+        if (!enabled) {
+            membership.index.reset();
+            return;
+        }
+        if (!membership.index) {
+            std::unique_ptr<MembershipIndex> index(new CountingHashIndex());
+            for (const T& element : data()) {
+                index->insert(element);
+            }
+            membership.index = std::move(index);
+        }
+    }
+
+    bool hasMembershipIndex() const {
+        return membership.index != nullptr;
+    }
+
+    CacheStats cacheStats() const {
+        std::lock_guard<std::mutex> guard(cacheLock);
+        return stats;
+    }
+
+    // Keeps the sorted index maintained across add() calls: appended elements
+    // are merged in on the next sorted traversal instead of triggering a full sort
+    void setIncrementalSort(bool enabled) {
+        incrementalSort = enabled;
+    }
+
+    bool isIncrementalSort() const {
+        return incrementalSort;
+    }
+
+    // Selects how the sorted index is built; the resulting order is the same
+    void setSortAlgorithm(SortAlgorithm algorithm) {
+        sortAlgorithm = algorithm;
     }
 
-    // Output operator
-    friend std::ostream& operator<<(std::ostream& os, const MyContainer<T>& container) {
-        os << "[";
-        for (size_t i = 0; i < container.data.size(); ++i) {
-            if (i > 0) os << ", ";
-            os << container.data[i];
+    SortAlgorithm getSortAlgorithm() const {
+        return sortAlgorithm;
+    }
+
+    // Number of threads used to build the sorted index of large containers
+    // (0, the default, means one per hardware thread; 1 keeps sorting serial)
+    void setSortThreads(unsigned threads) {
+        sortThreads = threads;
+    }
+
+    unsigned getSortThreads() const {
+        return sortThreads;
+    }
+
+    // Makes copies of this container O(1): they share the storage, sorted
+    // index and membership index with it, exactly like snapshot(), until
+    // either side changes. Copies inherit the setting. Off by default, since
+    // the first change after a copy then pays for copying the storage.
+    void setCopyOnWrite(bool enabled) {
+        copyOnWrite = enabled;
+    }
+
+    bool isCopyOnWrite() const {
+        return copyOnWrite;
+    }
+
+    // Output operator. Numbers and strings are formatted in large chunks
+    // when the stream has default flags and the classic locale; the output
+    // is the same as printing each element with operator<<.
+    friend std::ostream& operator<<(std::ostream& os, const MyContainer& container) {
+        const Storage& elements = container.data();
+        return text::writeSequence<T>(os, elements.begin(), elements.end());
+    }
+
+    // Input operator: skips whitespace and reads one "[a, b, c]" list,
+    // appending its elements. On malformed input it sets failbit and leaves
+    // the container unchanged.
+    friend std::istream& operator>>(std::istream& is, MyContainer& container) {
+        std::istream::sentry ready(is);
+        if (!ready) {
+            return is;
         }
-        os << "]";
-        return os;
+        if (is.peek() != '[') {
+            is.setstate(std::ios_base::failbit);
+            return is;
+        }
+        std::string list;
+        if (!std::getline(is, list, ']')) {
+            return is;
+        }
+        // getline stops at the end of the stream too, without a ']'
+        if (is.eof()) {
+            is.setstate(std::ios_base::failbit);
+            return is;
+        }
+        list += ']';
+        try {
+            container.addText(list.data(), list.data() + list.size());
+        } catch (const std::invalid_argument&) {
+            is.setstate(std::ios_base::failbit);
+        }
+        return is;
+    }
+
+    // Appends the elements written in [first, last): either one list as
+    // printed by operator<<, or elements separated by commas or newlines
+    // (see text::parseSequence). Throws std::invalid_argument on malformed
+    // input, leaving the container unchanged.
+    void addText(const char* first, const char* last) {
+        Storage& elements = writable();
+        size_t before = elements.size();
+        try {
+            text::parseSequence<T>(first, last, elements);
+        } catch (...) {
+            elements.erase(elements.begin() + static_cast<std::ptrdiff_t>(before), elements.end());
+            throw;
+        }
+        appended(elements.size() - before);
+    }
+
+    static MyContainer parse(const std::string& text, const Allocator& allocator = Allocator()) {
+        MyContainer result(allocator);
+        result.addText(text.data(), text.data() + text.size());
+        return result;
+    }
+
+    // Parses the whole file at path, read in one block
+    static MyContainer parseFile(const std::string& path, const Allocator& allocator = Allocator()) {
+        return parse(text::readFile(path), allocator);
+    }
+
+    // Print the elements in one of the iteration orders, in the format of
+    // operator<<
+    std::ostream& printAscending(std::ostream& os) const {
+        return printView(os, ascending());
+    }
+
+    std::ostream& printDescending(std::ostream& os) const {
+        return printView(os, descending());
+    }
+
+    std::ostream& printSideCross(std::ostream& os) const {
+        return printView(os, sideCross());
+    }
+
+    std::ostream& printReverse(std::ostream& os) const {
+        return printView(os, reverse());
+    }
+
+    std::ostream& printOrder(std::ostream& os) const {
+        return printView(os, order());
+    }
+
+    std::ostream& printMiddleOut(std::ostream& os) const {
+        return printView(os, middleOut());
+    }
+
+    // Writes the elements to a binary container file (see BinaryFormat.hpp),
+    // replacing it only once complete. T must be trivially copyable or
+    // std::string.
+    void save(const std::string& path) const {
+        const Storage& elements = data();
+        binary::save(path, elements.data(), elements.size());
+    }
+
+    // Reads a file written by save(); throws std::runtime_error if path does
+    // not hold elements of type T. Settings start at their defaults.
+    static MyContainer load(const std::string& path, const Allocator& allocator = Allocator()) {
+        MyContainer result(allocator);
+        binary::load(path, result.writable());
+        result.appended(result.size());
+        return result;
     }
 
     // Iterator classes
-    
+    //
+    // Each order is a lightweight view over the container's storage: it keeps a
+    // pointer to the elements and, for the sorted orders, a compact
+    // permutation of element positions. The other orders compute each
+    // position arithmetically from the step number. The elements themselves are never
+    // copied, so a view is invalidated by add()/remove() like a std iterator.
+    // The permutation is immutable and shared between all copies of a view,
+    // which makes begin(), end() and comparisons O(1) and allocation-free.
+
     // AscendingOrder Iterator - sorts in ascending order
     class AscendingOrder {
     private:
-        std::vector<T> sortedData;
+        const Storage* source;
+        std::shared_ptr<const IndexVector> indices;
+        size_t length;
         size_t currentIndex;
         
     public:
-        AscendingOrder(const std::vector<T>& data) : sortedData(data), currentIndex(0) {
-            std::sort(sortedData.begin(), sortedData.end());
-        }
+        AscendingOrder(const Storage& data, std::shared_ptr<const IndexVector> ascendingIndices)
+            : source(&data), indices(std::move(ascendingIndices)), length(indices->size()), currentIndex(0) {}
 
         AscendingOrder& operator++() {
-            if (currentIndex < sortedData.size()) {
+            if (currentIndex < length) {
                 currentIndex++;
             }
             return *this;
         }
 
         const T& operator*() const {
-            if (currentIndex >= sortedData.size()) {
+            if (currentIndex >= length) {
                 throw std::out_of_range("Iterator out of range");
             }
-            return sortedData[currentIndex];
+            return (*source)[(*indices)[currentIndex]];
         }
 
         bool operator!=(const AscendingOrder& other) const {
@@ -98,34 +1146,35 @@ public:
 
         AscendingOrder end() const {
             AscendingOrder iter(*this);
-            iter.currentIndex = sortedData.size();
+            iter.currentIndex = length;
             return iter;
         }
     };
 
-    // DescendingOrder Iterator - sorts in descending order
+    // DescendingOrder Iterator - walks the ascending permutation backwards
     class DescendingOrder {
     private:
-        std::vector<T> sortedData;
+        const Storage* source;
+        std::shared_ptr<const IndexVector> indices;
+        size_t length;
         size_t currentIndex;
         
     public:
-        DescendingOrder(const std::vector<T>& data) : sortedData(data), currentIndex(0) {
-            std::sort(sortedData.begin(), sortedData.end(), std::greater<T>());
-        }
+        DescendingOrder(const Storage& data, std::shared_ptr<const IndexVector> ascendingIndices)
+            : source(&data), indices(std::move(ascendingIndices)), length(indices->size()), currentIndex(0) {}
 
         DescendingOrder& operator++() {
-            if (currentIndex < sortedData.size()) {
+            if (currentIndex < length) {
                 currentIndex++;
             }
             return *this;
         }
 
         const T& operator*() const {
-            if (currentIndex >= sortedData.size()) {
+            if (currentIndex >= length) {
                 throw std::out_of_range("Iterator out of range");
             }
-            return sortedData[currentIndex];
+            return (*source)[(*indices)[length - 1 - currentIndex]];
         }
 
         bool operator!=(const DescendingOrder& other) const {
@@ -144,7 +1193,7 @@ public:
 
         DescendingOrder end() const {
             DescendingOrder iter(*this);
-            iter.currentIndex = sortedData.size();
+            iter.currentIndex = length;
             return iter;
         }
     };
@@ -152,48 +1201,27 @@ public:
     // SideCrossOrder Iterator - alternates between smallest and largest
     class SideCrossOrder {
     private:
-        std::vector<T> sortedData;
+        const Storage* source;
+        std::shared_ptr<const IndexVector> indices;
+        size_t length;
         size_t currentIndex;
         
     public:
-        SideCrossOrder(const std::vector<T>& data) : sortedData(), currentIndex(0) {
-            if (!data.empty()) {
-                std::vector<T> temp = data;
-                std::sort(temp.begin(), temp.end());
-                
-                sortedData.clear();
-                size_t left = 0, right = temp.size() - 1;
-                bool takeLeft = true;
-                
-                while (left <= right) {
-                    if (takeLeft) {
-                        sortedData.push_back(temp[left]);
-                        left++;
-                    } else {
-                        sortedData.push_back(temp[right]);
-                        if (right > 0) right--;
-                        else break;
-                    }
-                    takeLeft = !takeLeft;
-                    
-                    // Break if left exceeds right
-                    if (left > right) break;
-                }
-            }
-        }
+        SideCrossOrder(const Storage& data, std::shared_ptr<const IndexVector> ascendingIndices)
+            : source(&data), indices(std::move(ascendingIndices)), length(indices->size()), currentIndex(0) {}
 
         SideCrossOrder& operator++() {
-            if (currentIndex < sortedData.size()) {
+            if (currentIndex < length) {
                 currentIndex++;
             }
             return *this;
         }
 
         const T& operator*() const {
-            if (currentIndex >= sortedData.size()) {
+            if (currentIndex >= length) {
                 throw std::out_of_range("Iterator out of range");
             }
-            return sortedData[currentIndex];
+            return (*source)[(*indices)[detail::sideCrossRank(currentIndex, length)]];
         }
 
         bool operator!=(const SideCrossOrder& other) const {
@@ -212,7 +1240,7 @@ public:
 
         SideCrossOrder end() const {
             SideCrossOrder iter(*this);
-            iter.currentIndex = sortedData.size();
+            iter.currentIndex = length;
             return iter;
         }
     };
@@ -220,26 +1248,25 @@ public:
     // ReverseOrder Iterator - reverses the original order
     class ReverseOrder {
     private:
-        std::vector<T> reversedData;
+        const Storage* source;
+        size_t length;
         size_t currentIndex;
         
     public:
-        ReverseOrder(const std::vector<T>& data) : reversedData(data), currentIndex(0) {
-            std::reverse(reversedData.begin(), reversedData.end());
-        }
+        ReverseOrder(const Storage& data) : source(&data), length(data.size()), currentIndex(0) {}
 
         ReverseOrder& operator++() {
-            if (currentIndex < reversedData.size()) {
+            if (currentIndex < length) {
                 currentIndex++;
             }
             return *this;
         }
 
         const T& operator*() const {
-            if (currentIndex >= reversedData.size()) {
+            if (currentIndex >= length) {
                 throw std::out_of_range("Iterator out of range");
             }
-            return reversedData[currentIndex];
+            return (*source)[length - 1 - currentIndex];
         }
 
         bool operator!=(const ReverseOrder& other) const {
@@ -258,7 +1285,7 @@ public:
 
         ReverseOrder end() const {
             ReverseOrder iter(*this);
-            iter.currentIndex = reversedData.size();
+            iter.currentIndex = length;
             return iter;
         }
     };
@@ -266,26 +1293,27 @@ public:
     // Order Iterator - maintains original insertion order
     class Order {
     private:
-        std::vector<T> originalData;
+        const Storage* source;
+        size_t length;
         size_t currentIndex;
         
     public:
-        Order(const std::vector<T>& data) : originalData(data), currentIndex(0) {
+        Order(const Storage& data) : source(&data), length(data.size()), currentIndex(0) {
             // Keep original order - no changes needed
         }
 
         Order& operator++() {
-            if (currentIndex < originalData.size()) {
+            if (currentIndex < length) {
                 currentIndex++;
             }
             return *this;
         }
 
         const T& operator*() const {
-            if (currentIndex >= originalData.size()) {
+            if (currentIndex >= length) {
                 throw std::out_of_range("Iterator out of range");
             }
-            return originalData[currentIndex];
+            return (*source)[currentIndex];
         }
 
         bool operator!=(const Order& other) const {
@@ -304,7 +1332,7 @@ public:
 
         Order end() const {
             Order iter(*this);
-            iter.currentIndex = originalData.size();
+            iter.currentIndex = length;
             return iter;
         }
     };
@@ -312,62 +1340,25 @@ public:
     // MiddleOutOrder Iterator - starts from middle, then alternates left-right
     class MiddleOutOrder {
     private:
-        std::vector<T> middleOutData;
+        const Storage* source;
+        size_t length;
         size_t currentIndex;
         
     public:
-        MiddleOutOrder(const std::vector<T>& data) : middleOutData(), currentIndex(0) {
-            if (!data.empty()) {
-                middleOutData.clear();
-                
-                size_t middle = data.size() / 2;
-                middleOutData.push_back(data[middle]);
-                
-                // For [7,15,6,1,2] (indices 0,1,2,3,4): 
-                // middle=2, so start with data[2]=6
-                // Expected pattern: 6,15,1,7,2
-                // This means: middle, left, right, left, right
-                
-                int left = static_cast<int>(middle) - 1;  // Start at middle-1
-                size_t right = middle + 1;                // Start at middle+1
-                bool takeLeft = true;  // Start with left after middle
-                
-                while (middleOutData.size() < data.size()) {
-                    if (takeLeft && left >= 0) {
-                        middleOutData.push_back(data[left]);
-                        left--;
-                        takeLeft = false;
-                    } else if (!takeLeft && right < data.size()) {
-                        middleOutData.push_back(data[right]);
-                        right++;
-                        takeLeft = true;
-                    } else if (left >= 0) {
-                        // Only left elements remain
-                        middleOutData.push_back(data[left]);
-                        left--;
-                    } else if (right < data.size()) {
-                        // Only right elements remain
-                        middleOutData.push_back(data[right]);
-                        right++;
-                    } else {
-                        break;
-                    }
-                }
-            }
-        }
+        MiddleOutOrder(const Storage& data) : source(&data), length(data.size()), currentIndex(0) {}
 
         MiddleOutOrder& operator++() {
-            if (currentIndex < middleOutData.size()) {
+            if (currentIndex < length) {
                 currentIndex++;
             }
             return *this;
         }
 
         const T& operator*() const {
-            if (currentIndex >= middleOutData.size()) {
+            if (currentIndex >= length) {
                 throw std::out_of_range("Iterator out of range");
             }
-            return middleOutData[currentIndex];
+            return (*source)[detail::middleOutPosition(currentIndex, length)];
         }
 
         bool operator!=(const MiddleOutOrder& other) const {
@@ -386,34 +1377,161 @@ public:
 
         MiddleOutOrder end() const {
             MiddleOutOrder iter(*this);
-            iter.currentIndex = middleOutData.size();
+            iter.currentIndex = length;
+            return iter;
+        }
+    };
+
+    // LazyAscendingOrder Iterator - ascending order produced on demand, for
+    // traversals that only read the first few elements
+    class LazyAscendingOrder {
+    private:
+        typedef LazySelection<IndexGreater> Selection;
+
+        const Storage* source;
+        std::shared_ptr<Selection> selection;
+        size_t length;
+        size_t currentIndex;
+        
+    public:
+        LazyAscendingOrder(const Storage& data)
+            : source(&data),
+              selection(std::allocate_shared<Selection>(data.get_allocator(), identityIndices(data), IndexGreater{data.cbegin()})),
+              length(data.size()), currentIndex(0) {}
+
+        LazyAscendingOrder(const Storage& data, const IndexVector& ascendingIndices)
+            : source(&data),
+              selection(std::allocate_shared<Selection>(data.get_allocator(),
+                  IndexVector(ascendingIndices.rbegin(), ascendingIndices.rend(), ascendingIndices.get_allocator()),
+                  IndexGreater{data.cbegin()}, 0)),
+              length(data.size()), currentIndex(0) {}
+
+        LazyAscendingOrder& operator++() {
+            if (currentIndex < length) {
+                currentIndex++;
+            }
+            return *this;
+        }
+
+        const T& operator*() const {
+            if (currentIndex >= length) {
+                throw std::out_of_range("Iterator out of range");
+            }
+            return (*source)[selection->at(currentIndex)];
+        }
+
+        bool operator!=(const LazyAscendingOrder& other) const {
+            return currentIndex != other.currentIndex;
+        }
+
+        bool operator==(const LazyAscendingOrder& other) const {
+            return currentIndex == other.currentIndex;
+        }
+
+        LazyAscendingOrder begin() const {
+            LazyAscendingOrder iter(*this);
+            iter.currentIndex = 0;
+            return iter;
+        }
+
+        LazyAscendingOrder end() const {
+            LazyAscendingOrder iter(*this);
+            iter.currentIndex = length;
+            return iter;
+        }
+    };
+
+    // LazyDescendingOrder Iterator - descending order produced on demand
+    class LazyDescendingOrder {
+    private:
+        typedef LazySelection<IndexLess> Selection;
+
+        const Storage* source;
+        std::shared_ptr<Selection> selection;
+        size_t length;
+        size_t currentIndex;
+        
+    public:
+        LazyDescendingOrder(const Storage& data)
+            : source(&data),
+              selection(std::allocate_shared<Selection>(data.get_allocator(), identityIndices(data), IndexLess{data.cbegin()})),
+              length(data.size()), currentIndex(0) {}
+
+        LazyDescendingOrder(const Storage& data, const IndexVector& ascendingIndices)
+            : source(&data),
+              selection(std::allocate_shared<Selection>(data.get_allocator(),
+                  IndexVector(ascendingIndices), IndexLess{data.cbegin()}, 0)),
+              length(data.size()), currentIndex(0) {}
+
+        LazyDescendingOrder& operator++() {
+            if (currentIndex < length) {
+                currentIndex++;
+            }
+            return *this;
+        }
+
+        const T& operator*() const {
+            if (currentIndex >= length) {
+                throw std::out_of_range("Iterator out of range");
+            }
+            return (*source)[selection->at(currentIndex)];
+        }
+
+        bool operator!=(const LazyDescendingOrder& other) const {
+            return currentIndex != other.currentIndex;
+        }
+
+        bool operator==(const LazyDescendingOrder& other) const {
+            return currentIndex == other.currentIndex;
+        }
+
+        LazyDescendingOrder begin() const {
+            LazyDescendingOrder iter(*this);
+            iter.currentIndex = 0;
+            return iter;
+        }
+
+        LazyDescendingOrder end() const {
+            LazyDescendingOrder iter(*this);
+            iter.currentIndex = length;
             return iter;
         }
     };
 
     // Iterator factory methods
     AscendingOrder ascending() const {
-        return AscendingOrder(data);
+        return AscendingOrder(data(), ascendingIndices());
     }
 
     DescendingOrder descending() const {
-        return DescendingOrder(data);
+        return DescendingOrder(data(), ascendingIndices());
     }
 
     SideCrossOrder sideCross() const {
-        return SideCrossOrder(data);
+        return SideCrossOrder(data(), ascendingIndices());
     }
 
     ReverseOrder reverse() const {
-        return ReverseOrder(data);
+        return ReverseOrder(data());
     }
 
     Order order() const {
-        return Order(data);
+        return Order(data());
     }
 
     MiddleOutOrder middleOut() const {
-        return MiddleOutOrder(data);
+        return MiddleOutOrder(data());
+    }
+
+    // Lazy variants reuse a current sorted index, but never build one
+    LazyAscendingOrder lazyAscending() const {
+        std::shared_ptr<const IndexVector> sorted = currentAscendingIndices();
+        return sorted ? LazyAscendingOrder(data(), *sorted) : LazyAscendingOrder(data());
+    }
+
+    LazyDescendingOrder lazyDescending() const {
+        std::shared_ptr<const IndexVector> sorted = currentAscendingIndices();
+        return sorted ? LazyDescendingOrder(data(), *sorted) : LazyDescendingOrder(data());
     }
 };
 
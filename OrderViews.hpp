@@ -0,0 +1,114 @@
+// tomergal40@gmail.com
+#ifndef ORDERVIEWS_HPP
+#define ORDERVIEWS_HPP
+
+#include <cstddef>
+#include <stdexcept>
+
+namespace mycontainers {
+namespace detail {
+
+// Rank in the ascending order visited at step of a sideCross walk: even
+// steps take the next smallest, odd steps the next largest
+inline size_t sideCrossRank(size_t step, size_t length) {
+    size_t taken = step / 2;
+    return (step % 2 == 0) ? taken : length - 1 - taken;
+}
+
+// Position visited at step of a middleOut walk. For [7,15,6,1,2] the middle
+// is data[2]=6, then the pattern is left, right, left, right: 6,15,1,7,2.
+// The left side is never shorter than the right one, so odd steps can
+// always go left and an even-sized container simply ends on data[0].
+inline size_t middleOutPosition(size_t step, size_t length) {
+    size_t middle = length / 2;
+    size_t distance = (step + 1) / 2;
+    return (step % 2 == 1) ? middle - distance : middle + distance;
+}
+
+// Orders positions by their elements; equal elements keep insertion order.
+// Data is anything indexed by position: a pointer or a random access iterator.
+template<typename Data>
+struct PositionLess {
+    Data data;
+
+    template<typename Index>
+    bool operator()(Index a, Index b) const {
+        if (data[a] < data[b]) return true;
+        if (data[b] < data[a]) return false;
+        return a < b;
+    }
+};
+
+// Reverses PositionLess: the top of a heap ordered by it is the smallest element
+template<typename Data>
+struct PositionGreater {
+    Data data;
+
+    template<typename Index>
+    bool operator()(Index a, Index b) const {
+        return PositionLess<Data>{data}(b, a);
+    }
+};
+
+enum class Walk { Ascending, Descending, SideCross, Reverse, Order, MiddleOut };
+
+// Unsorted orders over a contiguous array, whose positions follow from the
+// step number alone
+template<typename T, Walk walk>
+class PlainView {
+    static_assert(walk == Walk::Reverse || walk == Walk::Order || walk == Walk::MiddleOut,
+                  "PlainView only walks unsorted orders");
+
+private:
+    const T* source;
+    size_t length;
+    size_t currentIndex;
+
+    size_t position() const {
+        if (walk == Walk::Order) return currentIndex;
+        if (walk == Walk::Reverse) return length - 1 - currentIndex;
+        return middleOutPosition(currentIndex, length);
+    }
+
+public:
+    PlainView(const T* data, size_t count) : source(data), length(count), currentIndex(0) {}
+
+    PlainView& operator++() {
+        if (currentIndex < length) {
+            currentIndex++;
+        }
+        return *this;
+    }
+
+    const T& operator*() const {
+        if (currentIndex >= length) {
+            throw std::out_of_range("Iterator out of range");
+        }
+        return source[position()];
+    }
+
+    bool operator!=(const PlainView& other) const {
+        return currentIndex != other.currentIndex;
+    }
+
+    bool operator==(const PlainView& other) const {
+        return currentIndex == other.currentIndex;
+    }
+
+    PlainView begin() const {
+        PlainView iter(*this);
+        iter.currentIndex = 0;
+        return iter;
+    }
+
+    PlainView end() const {
+        PlainView iter(*this);
+        iter.currentIndex = length;
+        return iter;
+    }
+};
+
+} // namespace detail
+} // namespace mycontainers
+
+#endif // ORDERVIEWS_HPP
@@ -0,0 +1,386 @@
+// tomergal40@gmail.com
+#ifndef SIMDKERNELS_HPP
+#define SIMDKERNELS_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MYCONTAINER_SIMD_X86 1
+#include <immintrin.h>
+#define MYCONTAINER_TARGET(isa) __attribute__((target(isa)))
+#else
+#define MYCONTAINER_SIMD_X86 0
+#endif
+
+namespace mycontainers {
+namespace simd {
+
+// Instruction sets the kernels can use, in increasing order
+enum class Level { Scalar, Sse41, Avx2 };
+
+// Best level this CPU supports, detected once
+inline Level detectedLevel() {
+#if MYCONTAINER_SIMD_X86
+    static const Level detected = []() {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return Level::Avx2;
+        if (__builtin_cpu_supports("sse4.1")) return Level::Sse41;
+        return Level::Scalar;
+    }();
+    return detected;
+#else
+    return Level::Scalar;
+#endif
+}
+
+inline std::atomic<int>& selectedLevel() {
+    static std::atomic<int> selected(static_cast<int>(detectedLevel()));
+    return selected;
+}
+
+// Level the kernels dispatch to
+inline Level activeLevel() {
+    return static_cast<Level>(selectedLevel().load(std::memory_order_relaxed));
+}
+
+// Restricts dispatch to at most the given level (for benchmarks and tests);
+// levels the CPU lacks are never selected
+inline void setLevel(Level level) {
+    Level capped = std::min(level, detectedLevel());
+    selectedLevel().store(static_cast<int>(capped), std::memory_order_relaxed);
+}
+
+// Element types with vector kernels: 32/64-bit integers, float and double.
+// Integers compare bitwise; floats compare like operator== (NaN never
+// matches, -0.0 matches 0.0).
+template<typename T>
+struct Supported {
+    static const bool value = (std::is_integral<T>::value && (sizeof(T) == 4 || sizeof(T) == 8)) ||
+                              std::is_same<T, float>::value || std::is_same<T, double>::value;
+};
+
+#if MYCONTAINER_SIMD_X86
+namespace kernels {
+
+// Broadcast bit pattern of a value, as the matching integer type
+template<typename T>
+typename std::conditional<sizeof(T) == 4, std::uint32_t, std::uint64_t>::type bitsOf(T value) {
+    typename std::conditional<sizeof(T) == 4, std::uint32_t, std::uint64_t>::type bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+// Per-level operations on T lanes: broadcast, unaligned load/store, and the
+// bit mask of lanes equal to the probe
+template<typename T, typename Enable = void> struct Avx2Ops;
+template<typename T, typename Enable = void> struct Sse41Ops;
+
+template<typename T>
+struct Avx2Ops<T, typename std::enable_if<sizeof(T) == 4>::type> {
+    typedef __m256i Vec;
+    static const size_t lanes = 8;
+    MYCONTAINER_TARGET("avx2") static Vec broadcast(T value) {
+        return _mm256_set1_epi32(static_cast<int>(bitsOf(value)));
+    }
+    MYCONTAINER_TARGET("avx2") static Vec load(const T* p) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    }
+    MYCONTAINER_TARGET("avx2") static void store(T* p, Vec v) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+    }
+    MYCONTAINER_TARGET("avx2") static unsigned matches(Vec a, Vec b) {
+        __m256 equal = std::is_floating_point<T>::value
+            ? _mm256_cmp_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), _CMP_EQ_OQ)
+            : _mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b));
+        return static_cast<unsigned>(_mm256_movemask_ps(equal));
+    }
+};
+
+template<typename T>
+struct Avx2Ops<T, typename std::enable_if<sizeof(T) == 8>::type> {
+    typedef __m256i Vec;
+    static const size_t lanes = 4;
+    MYCONTAINER_TARGET("avx2") static Vec broadcast(T value) {
+        return _mm256_set1_epi64x(static_cast<long long>(bitsOf(value)));
+    }
+    MYCONTAINER_TARGET("avx2") static Vec load(const T* p) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    }
+    MYCONTAINER_TARGET("avx2") static void store(T* p, Vec v) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+    }
+    MYCONTAINER_TARGET("avx2") static unsigned matches(Vec a, Vec b) {
+        __m256d equal = std::is_floating_point<T>::value
+            ? _mm256_cmp_pd(_mm256_castsi256_pd(a), _mm256_castsi256_pd(b), _CMP_EQ_OQ)
+            : _mm256_castsi256_pd(_mm256_cmpeq_epi64(a, b));
+        return static_cast<unsigned>(_mm256_movemask_pd(equal));
+    }
+};
+
+template<typename T>
+struct Sse41Ops<T, typename std::enable_if<sizeof(T) == 4>::type> {
+    typedef __m128i Vec;
+    static const size_t lanes = 4;
+    MYCONTAINER_TARGET("sse4.1") static Vec broadcast(T value) {
+        return _mm_set1_epi32(static_cast<int>(bitsOf(value)));
+    }
+    MYCONTAINER_TARGET("sse4.1") static Vec load(const T* p) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    }
+    MYCONTAINER_TARGET("sse4.1") static void store(T* p, Vec v) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+    }
+    MYCONTAINER_TARGET("sse4.1") static unsigned matches(Vec a, Vec b) {
+        __m128 equal = std::is_floating_point<T>::value
+            ? _mm_cmpeq_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b))
+            : _mm_castsi128_ps(_mm_cmpeq_epi32(a, b));
+        return static_cast<unsigned>(_mm_movemask_ps(equal));
+    }
+};
+
+template<typename T>
+struct Sse41Ops<T, typename std::enable_if<sizeof(T) == 8>::type> {
+    typedef __m128i Vec;
+    static const size_t lanes = 2;
+    MYCONTAINER_TARGET("sse4.1") static Vec broadcast(T value) {
+        return _mm_set1_epi64x(static_cast<long long>(bitsOf(value)));
+    }
+    MYCONTAINER_TARGET("sse4.1") static Vec load(const T* p) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    }
+    MYCONTAINER_TARGET("sse4.1") static void store(T* p, Vec v) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+    }
+    MYCONTAINER_TARGET("sse4.1") static unsigned matches(Vec a, Vec b) {
+        __m128d equal = std::is_floating_point<T>::value
+            ? _mm_cmpeq_pd(_mm_castsi128_pd(a), _mm_castsi128_pd(b))
+            : _mm_castsi128_pd(_mm_cmpeq_epi64(a, b));
+        return static_cast<unsigned>(_mm_movemask_pd(equal));
+    }
+};
+
+// Set bits in a lane mask (at most 8 bits); avoids relying on POPCNT,
+// which SSE4.1 does not imply
+inline size_t bitCount(unsigned mask) {
+    static const unsigned char nibbleBits[16] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+    return nibbleBits[mask & 15] + nibbleBits[mask >> 4];
+}
+
+// The kernels are instantiated once per level; the target attribute lets
+// the Ops helpers inline into them
+
+#define MYCONTAINER_KERNELS(isa, Ops)                                                           \
+    template<typename T>                                                                        \
+    MYCONTAINER_TARGET(isa) size_t find(const T* data, size_t length, T value, Ops<T>*) {       \
+        typedef Ops<T> O;                                                                       \
+        typename O::Vec probe = O::broadcast(value);                                            \
+        size_t i = 0;                                                                           \
+        for (; i + O::lanes <= length; i += O::lanes) {                                         \
+            unsigned mask = O::matches(O::load(data + i), probe);                               \
+            if (mask != 0) {                                                                    \
+                return i + static_cast<size_t>(__builtin_ctz(mask));                            \
+            }                                                                                   \
+        }                                                                                       \
+        for (; i < length; ++i) {                                                               \
+            if (data[i] == value) return i;                                                     \
+        }                                                                                       \
+        return length;                                                                          \
+    }                                                                                           \
+                                                                                                \
+    template<typename T>                                                                        \
+    MYCONTAINER_TARGET(isa) size_t count(const T* data, size_t length, T value, Ops<T>*) {      \
+        typedef Ops<T> O;                                                                       \
+        typename O::Vec probe = O::broadcast(value);                                            \
+        size_t found = 0, i = 0;                                                                \
+        for (; i + O::lanes <= length; i += O::lanes) {                                         \
+            unsigned mask = O::matches(O::load(data + i), probe);                               \
+            found += bitCount(mask);                                                            \
+        }                                                                                       \
+        for (; i < length; ++i) {                                                               \
+            found += data[i] == value;                                                          \
+        }                                                                                       \
+        return found;                                                                           \
+    }                                                                                           \
+                                                                                                \
+    /* Stable compaction: blocks without a match move as one vector, */                         \
+    /* blocks with matches are compacted lane by lane */                                        \
+    template<typename T>                                                                        \
+    MYCONTAINER_TARGET(isa) size_t remove(T* data, size_t length, T value, Ops<T>*) {           \
+        typedef Ops<T> O;                                                                       \
+        typename O::Vec probe = O::broadcast(value);                                            \
+        size_t out = 0, i = 0;                                                                  \
+        for (; i + O::lanes <= length; i += O::lanes) {                                         \
+            typename O::Vec block = O::load(data + i);                                          \
+            unsigned mask = O::matches(block, probe);                                           \
+            if (mask == 0) {                                                                    \
+                O::store(data + out, block);                                                    \
+                out += O::lanes;                                                                \
+            } else {                                                                            \
+                for (size_t lane = 0; lane < O::lanes; ++lane) {                                \
+                    if (!(mask & (1u << lane))) data[out++] = data[i + lane];                   \
+                }                                                                               \
+            }                                                                                   \
+        }                                                                                       \
+        for (; i < length; ++i) {                                                               \
+            if (!(data[i] == value)) data[out++] = data[i];                                     \
+        }                                                                                       \
+        return out;                                                                             \
+    }
+
+MYCONTAINER_KERNELS("avx2", Avx2Ops)
+MYCONTAINER_KERNELS("sse4.1", Sse41Ops)
+
+#undef MYCONTAINER_KERNELS
+
+// Byte scanning for the text parser: bit masks of the bytes equal to either
+// of two delimiters, 32 or 16 bytes at a time
+struct Avx2Bytes {
+    typedef __m256i Vec;
+    static const size_t lanes = 32;
+    MYCONTAINER_TARGET("avx2") static Vec broadcast(char c) {
+        return _mm256_set1_epi8(c);
+    }
+    MYCONTAINER_TARGET("avx2") static unsigned matches(const char* p, Vec a, Vec b) {
+        Vec block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        return static_cast<unsigned>(
+            _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(block, a), _mm256_cmpeq_epi8(block, b))));
+    }
+};
+
+struct Sse41Bytes {
+    typedef __m128i Vec;
+    static const size_t lanes = 16;
+    MYCONTAINER_TARGET("sse4.1") static Vec broadcast(char c) {
+        return _mm_set1_epi8(c);
+    }
+    MYCONTAINER_TARGET("sse4.1") static unsigned matches(const char* p, Vec a, Vec b) {
+        Vec block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        return static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, a), _mm_cmpeq_epi8(block, b))));
+    }
+};
+
+// Set bits in a 32-bit mask, without relying on POPCNT
+inline size_t wideBitCount(unsigned mask) {
+    return bitCount(mask & 0xff) + bitCount((mask >> 8) & 0xff) + bitCount((mask >> 16) & 0xff) + bitCount(mask >> 24);
+}
+
+#define MYCONTAINER_BYTE_KERNELS(isa, Ops)                                                      \
+    MYCONTAINER_TARGET(isa) inline size_t findEither(const char* data, size_t length, char a,   \
+                                                     char b, Ops*) {                            \
+        Ops::Vec first = Ops::broadcast(a), second = Ops::broadcast(b);                         \
+        size_t i = 0;                                                                           \
+        for (; i + Ops::lanes <= length; i += Ops::lanes) {                                     \
+            unsigned mask = Ops::matches(data + i, first, second);                              \
+            if (mask != 0) {                                                                    \
+                return i + static_cast<size_t>(__builtin_ctz(mask));                            \
+            }                                                                                   \
+        }                                                                                       \
+        for (; i < length; ++i) {                                                               \
+            if (data[i] == a || data[i] == b) return i;                                         \
+        }                                                                                       \
+        return length;                                                                          \
+    }                                                                                           \
+                                                                                                \
+    MYCONTAINER_TARGET(isa) inline size_t countEither(const char* data, size_t length, char a,  \
+                                                      char b, Ops*) {                           \
+        Ops::Vec first = Ops::broadcast(a), second = Ops::broadcast(b);                         \
+        size_t found = 0, i = 0;                                                                \
+        for (; i + Ops::lanes <= length; i += Ops::lanes) {                                     \
+            found += wideBitCount(Ops::matches(data + i, first, second));                       \
+        }                                                                                       \
+        for (; i < length; ++i) {                                                               \
+            found += data[i] == a || data[i] == b;                                              \
+        }                                                                                       \
+        return found;                                                                           \
+    }
+
+MYCONTAINER_BYTE_KERNELS("avx2", Avx2Bytes)
+MYCONTAINER_BYTE_KERNELS("sse4.1", Sse41Bytes)
+
+#undef MYCONTAINER_BYTE_KERNELS
+
+} // namespace kernels
+#endif
+
+// Position of the first element equal to value, or length if there is none
+template<typename T>
+typename std::enable_if<Supported<T>::value, size_t>::type
+find(const T* data, size_t length, T value) {
+#if MYCONTAINER_SIMD_X86
+    switch (activeLevel()) {
+    case Level::Avx2: return kernels::find(data, length, value, static_cast<kernels::Avx2Ops<T>*>(nullptr));
+    case Level::Sse41: return kernels::find(data, length, value, static_cast<kernels::Sse41Ops<T>*>(nullptr));
+    case Level::Scalar: break;
+    }
+#endif
+    return static_cast<size_t>(std::find(data, data + length, value) - data);
+}
+
+// Number of elements equal to value
+template<typename T>
+typename std::enable_if<Supported<T>::value, size_t>::type
+count(const T* data, size_t length, T value) {
+#if MYCONTAINER_SIMD_X86
+    switch (activeLevel()) {
+    case Level::Avx2: return kernels::count(data, length, value, static_cast<kernels::Avx2Ops<T>*>(nullptr));
+    case Level::Sse41: return kernels::count(data, length, value, static_cast<kernels::Sse41Ops<T>*>(nullptr));
+    case Level::Scalar: break;
+    }
+#endif
+    return static_cast<size_t>(std::count(data, data + length, value));
+}
+
+// Moves the elements not equal to value to the front, keeping their order,
+// and returns how many there are (like std::remove)
+template<typename T>
+typename std::enable_if<Supported<T>::value, size_t>::type
+remove(T* data, size_t length, T value) {
+#if MYCONTAINER_SIMD_X86
+    switch (activeLevel()) {
+    case Level::Avx2: return kernels::remove(data, length, value, static_cast<kernels::Avx2Ops<T>*>(nullptr));
+    case Level::Sse41: return kernels::remove(data, length, value, static_cast<kernels::Sse41Ops<T>*>(nullptr));
+    case Level::Scalar: break;
+    }
+#endif
+    return static_cast<size_t>(std::remove(data, data + length, value) - data);
+}
+
+// Position of the first byte equal to a or b, or length if there is none
+inline size_t findEither(const char* data, size_t length, char a, char b) {
+#if MYCONTAINER_SIMD_X86
+    switch (activeLevel()) {
+    case Level::Avx2: return kernels::findEither(data, length, a, b, static_cast<kernels::Avx2Bytes*>(nullptr));
+    case Level::Sse41: return kernels::findEither(data, length, a, b, static_cast<kernels::Sse41Bytes*>(nullptr));
+    case Level::Scalar: break;
+    }
+#endif
+    for (size_t i = 0; i < length; ++i) {
+        if (data[i] == a || data[i] == b) return i;
+    }
+    return length;
+}
+
+// Number of bytes equal to a or b
+inline size_t countEither(const char* data, size_t length, char a, char b) {
+#if MYCONTAINER_SIMD_X86
+    switch (activeLevel()) {
+    case Level::Avx2: return kernels::countEither(data, length, a, b, static_cast<kernels::Avx2Bytes*>(nullptr));
+    case Level::Sse41: return kernels::countEither(data, length, a, b, static_cast<kernels::Sse41Bytes*>(nullptr));
+    case Level::Scalar: break;
+    }
+#endif
+    size_t found = 0;
+    for (size_t i = 0; i < length; ++i) {
+        found += data[i] == a || data[i] == b;
+    }
+    return found;
+}
+
+} // namespace simd
+} // namespace mycontainers
+
+#endif // SIMDKERNELS_HPP
@@ -0,0 +1,346 @@
+// tomergal40@gmail.com
+#ifndef SMALLMYCONTAINER_HPP
+#define SMALLMYCONTAINER_HPP
+
+#include "MyContainer.hpp"
+#include <new>
+
+namespace mycontainers {
+
+// MyContainer variant for containers that usually hold few elements. Up to
+// N elements live inside the object, and the sorted permutation is cached
+// inside the object and copied into each sorted view, so an inline
+// container never touches the heap. Adding element N + 1 moves everything
+// to a std::vector for good. The orders visit elements exactly as
+// MyContainer's do.
+template<typename T = int, size_t N = 16>
+class SmallMyContainer {
+    static_assert(N > 0, "SmallMyContainer needs an inline capacity");
+
+public:
+    // Position type of the sorted permutations, as in MyContainer
+    typedef std::uint32_t Index;
+
+    static const size_t inlineCapacity = N;
+
+private:
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type buffer[N];
+    size_t inlineCount = 0;
+    // Holds every element once the container has spilled
+    std::vector<T> spill;
+    bool spilled = false;
+
+    // Ascending permutation, built by the first sorted view after a change:
+    // inline in sorted[] or, once spilled, in spilledSorted
+    mutable Index sorted[N];
+    mutable bool sortedCurrent = false;
+    mutable std::shared_ptr<const std::vector<Index> > spilledSorted;
+
+    T* inlineData() {
+        return reinterpret_cast<T*>(buffer);
+    }
+
+    const T* inlineData() const {
+        return reinterpret_cast<const T*>(buffer);
+    }
+
+    const T* elements() const {
+        return spilled ? spill.data() : inlineData();
+    }
+
+    void destroyInline(size_t from) {
+        for (size_t i = from; i < inlineCount; ++i) {
+            inlineData()[i].~T();
+        }
+        inlineCount = from;
+    }
+
+    void changed() {
+        sortedCurrent = false;
+        spilledSorted.reset();
+    }
+
+    template<typename... Args>
+    void append(Args&&... args) {
+        changed();
+        if (spilled) {
+            spill.emplace_back(std::forward<Args>(args)...);
+            return;
+        }
+        if (inlineCount < N) {
+            new (inlineData() + inlineCount) T(std::forward<Args>(args)...);
+            inlineCount++;
+            return;
+        }
+        // Built before the move, since args may refer to an inline element
+        T element(std::forward<Args>(args)...);
+        std::vector<T> heap;
+        heap.reserve(2 * N);
+        for (size_t i = 0; i < inlineCount; ++i) {
+            heap.push_back(std::move(inlineData()[i]));
+        }
+        heap.push_back(std::move(element));
+        destroyInline(0);
+        spill.swap(heap);
+        spilled = true;
+    }
+
+    // Both expect this container to be empty and inline
+    void copyFrom(const SmallMyContainer& other) {
+        if (other.spilled) {
+            spill = other.spill;
+            spilled = true;
+            return;
+        }
+        for (size_t i = 0; i < other.inlineCount; ++i) {
+            append(other.inlineData()[i]);
+        }
+    }
+
+    void moveFrom(SmallMyContainer& other) {
+        if (other.spilled) {
+            spill = std::move(other.spill);
+            spilled = true;
+        } else {
+            for (size_t i = 0; i < other.inlineCount; ++i) {
+                append(std::move(other.inlineData()[i]));
+            }
+        }
+        other.clear();
+    }
+
+    void prepareSorted() const {
+        if (sortedCurrent) {
+            return;
+        }
+        size_t count = size();
+        if (count > static_cast<size_t>(std::numeric_limits<Index>::max())) {
+            throw std::length_error("Container too large for index permutation");
+        }
+        std::shared_ptr<std::vector<Index> > heap;
+        Index* first = sorted;
+        if (spilled) {
+            heap = std::make_shared<std::vector<Index> >(count);
+            first = heap->data();
+        }
+        for (size_t i = 0; i < count; ++i) {
+            first[i] = static_cast<Index>(i);
+        }
+        std::sort(first, first + count, detail::PositionLess<const T*>{elements()});
+        spilledSorted = heap;
+        sortedCurrent = true;
+    }
+
+    typedef detail::Walk Walk;
+
+    // Sorted orders: the permutation lives in the view while the container
+    // is inline and in a shared heap buffer once it has spilled
+    template<Walk walk>
+    class SortedView {
+    private:
+        const T* source;
+        Index positions[N];
+        std::shared_ptr<const std::vector<Index> > spilledPositions;
+        size_t length;
+        size_t currentIndex;
+
+        size_t rank() const {
+            if (walk == Walk::Ascending) return currentIndex;
+            if (walk == Walk::Descending) return length - 1 - currentIndex;
+            return detail::sideCrossRank(currentIndex, length);
+        }
+
+    public:
+        // Takes the inline permutation when heapPositions is empty
+        SortedView(const T* data, size_t count, const Index* inlinePositions,
+                   std::shared_ptr<const std::vector<Index> > heapPositions)
+            : source(data), positions(), spilledPositions(std::move(heapPositions)), length(count), currentIndex(0) {
+            if (!spilledPositions) {
+                std::copy(inlinePositions, inlinePositions + count, positions);
+            }
+        }
+
+        SortedView& operator++() {
+            if (currentIndex < length) {
+                currentIndex++;
+            }
+            return *this;
+        }
+
+        const T& operator*() const {
+            if (currentIndex >= length) {
+                throw std::out_of_range("Iterator out of range");
+            }
+            size_t at = rank();
+            return source[spilledPositions ? (*spilledPositions)[at] : positions[at]];
+        }
+
+        bool operator!=(const SortedView& other) const {
+            return currentIndex != other.currentIndex;
+        }
+
+        bool operator==(const SortedView& other) const {
+            return currentIndex == other.currentIndex;
+        }
+
+        SortedView begin() const {
+            SortedView iter(*this);
+            iter.currentIndex = 0;
+            return iter;
+        }
+
+        SortedView end() const {
+            SortedView iter(*this);
+            iter.currentIndex = length;
+            return iter;
+        }
+    };
+
+public:
+    typedef SortedView<Walk::Ascending> AscendingOrder;
+    typedef SortedView<Walk::Descending> DescendingOrder;
+    typedef SortedView<Walk::SideCross> SideCrossOrder;
+    typedef detail::PlainView<T, Walk::Reverse> ReverseOrder;
+    typedef detail::PlainView<T, Walk::Order> Order;
+    typedef detail::PlainView<T, Walk::MiddleOut> MiddleOutOrder;
+
+    // Constructors and destructor
+    SmallMyContainer() = default;
+
+    SmallMyContainer(const SmallMyContainer& other) {
+        copyFrom(other);
+    }
+
+    // The moved-from container is left empty
+    SmallMyContainer(SmallMyContainer&& other) noexcept(std::is_nothrow_move_constructible<T>::value) {
+        moveFrom(other);
+    }
+
+    SmallMyContainer& operator=(const SmallMyContainer& other) {
+        if (this != &other) {
+            SmallMyContainer copy(other);
+            clear();
+            moveFrom(copy);
+        }
+        return *this;
+    }
+
+    SmallMyContainer& operator=(SmallMyContainer&& other) noexcept(std::is_nothrow_move_constructible<T>::value) {
+        if (this != &other) {
+            clear();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    ~SmallMyContainer() {
+        destroyInline(0);
+    }
+
+    // Basic operations
+    void add(const T& element) {
+        append(element);
+    }
+
+    void add(T&& element) {
+        append(std::move(element));
+    }
+
+    template<typename... Args>
+    void emplace(Args&&... args) {
+        append(std::forward<Args>(args)...);
+    }
+
+    void remove(const T& element) {
+        // Remove ALL instances of the element
+        if (tryRemove(element) == 0) {
+            throw std::invalid_argument("Element not found in container");
+        }
+    }
+
+    // Removes all instances of element and returns how many were removed
+    size_t tryRemove(const T& element) {
+        size_t removed;
+        if (spilled) {
+            auto newEnd = std::remove(spill.begin(), spill.end(), element);
+            removed = static_cast<size_t>(spill.end() - newEnd);
+            spill.erase(newEnd, spill.end());
+        } else {
+            T* first = inlineData();
+            size_t kept = static_cast<size_t>(std::remove(first, first + inlineCount, element) - first);
+            removed = inlineCount - kept;
+            destroyInline(kept);
+        }
+        // Nothing moved when nothing matched, so the permutation still holds
+        if (removed > 0) {
+            changed();
+        }
+        return removed;
+    }
+
+    // Removes every element and returns to inline storage
+    void clear() {
+        changed();
+        destroyInline(0);
+        std::vector<T>().swap(spill);
+        spilled = false;
+    }
+
+    size_t size() const {
+        return spilled ? spill.size() : inlineCount;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    // Whether the elements have moved to the heap
+    bool isSpilled() const {
+        return spilled;
+    }
+
+    bool contains(const T& element) const {
+        return std::find(elements(), elements() + size(), element) != elements() + size();
+    }
+
+    size_t count(const T& element) const {
+        return static_cast<size_t>(std::count(elements(), elements() + size(), element));
+    }
+
+    // Output operator
+    friend std::ostream& operator<<(std::ostream& os, const SmallMyContainer& container) {
+        return text::writeSequence<T>(os, container.elements(), container.elements() + container.size());
+    }
+
+    // Iterator factory methods
+    AscendingOrder ascending() const {
+        prepareSorted();
+        return AscendingOrder(elements(), size(), sorted, spilledSorted);
+    }
+
+    DescendingOrder descending() const {
+        prepareSorted();
+        return DescendingOrder(elements(), size(), sorted, spilledSorted);
+    }
+
+    SideCrossOrder sideCross() const {
+        prepareSorted();
+        return SideCrossOrder(elements(), size(), sorted, spilledSorted);
+    }
+
+    ReverseOrder reverse() const {
+        return ReverseOrder(elements(), size());
+    }
+
+    Order order() const {
+        return Order(elements(), size());
+    }
+
+    MiddleOutOrder middleOut() const {
+        return MiddleOutOrder(elements(), size());
+    }
+};
+
+} // namespace mycontainers
+
+#endif // SMALLMYCONTAINER_HPP
@@ -0,0 +1,391 @@
+// tomergal40@gmail.com
+#ifndef TEXTFORMAT_HPP
+#define TEXTFORMAT_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <locale>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+#include "SimdKernels.hpp"
+
+namespace mycontainers {
+namespace text {
+
+// Characters collected before each write to the stream
+const size_t chunkSize = 32 * 1024;
+// Longest number the fast formatters produce, including snprintf's NUL:
+// a %g of up to maxPrecision digits, or a 64-bit integer and its sign
+const size_t maxNumberLength = 64;
+const std::streamsize maxPrecision = 40;
+
+// Whether os formats like a freshly constructed stream. Only then do the
+// fast formatters below produce exactly what operator<< would.
+inline bool plainStream(const std::ostream& os) {
+    return os.flags() == (std::ios_base::dec | std::ios_base::skipws) && os.width() == 0 &&
+           os.precision() <= maxPrecision && os.getloc() == std::locale::classic();
+}
+
+// Collects output in a chunk and hands it to the stream in large writes
+class Writer {
+private:
+    std::ostream& os;
+    char chunk[chunkSize];
+    size_t used = 0;
+
+public:
+    explicit Writer(std::ostream& stream) : os(stream) {}
+
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    // Room for at least length characters; commit() what was written
+    char* reserve(size_t length) {
+        if (used + length > chunkSize) {
+            flush();
+        }
+        return chunk + used;
+    }
+
+    void commit(const char* end) {
+        used = static_cast<size_t>(end - chunk);
+    }
+
+    void append(const char* characters, size_t length) {
+        if (length > chunkSize / 2) {
+            flush();
+            os.write(characters, static_cast<std::streamsize>(length));
+            return;
+        }
+        std::memcpy(reserve(length), characters, length);
+        used += length;
+    }
+
+    void flush() {
+        os.write(chunk, static_cast<std::streamsize>(used));
+        used = 0;
+    }
+};
+
+// Writes the decimal digits of value ending just before end and returns
+// where they start
+inline char* formatDigits(char* end, unsigned long long value) {
+    static const char pairs[] =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+    while (value >= 100) {
+        unsigned pair = static_cast<unsigned>(value % 100) * 2;
+        value /= 100;
+        *--end = pairs[pair + 1];
+        *--end = pairs[pair];
+    }
+    if (value >= 10) {
+        unsigned pair = static_cast<unsigned>(value) * 2;
+        *--end = pairs[pair + 1];
+        *--end = pairs[pair];
+    } else {
+        *--end = static_cast<char>('0' + value);
+    }
+    return end;
+}
+
+// How a plain stream prints T. The fast specializations write an element
+// into a Writer; the rest leave printing to operator<<.
+template<typename T, typename Enable = void>
+struct Formatter {
+    static const bool fast = false;
+};
+
+template<typename T>
+struct IsCharacter
+    : std::integral_constant<bool, std::is_same<T, char>::value || std::is_same<T, signed char>::value ||
+                                   std::is_same<T, unsigned char>::value || std::is_same<T, wchar_t>::value ||
+                                   std::is_same<T, char16_t>::value || std::is_same<T, char32_t>::value> {};
+
+// Integers, and bool, which prints as 0 or 1 without boolalpha
+template<typename T>
+struct Formatter<T, typename std::enable_if<std::is_integral<T>::value && !IsCharacter<T>::value>::type> {
+    static const bool fast = true;
+
+    static void write(Writer& out, T value, std::streamsize) {
+        char digits[24];
+        char* end = digits + sizeof(digits);
+        unsigned long long magnitude = static_cast<unsigned long long>(value);
+        bool negative = std::is_signed<T>::value && value < T();
+        if (negative) {
+            magnitude = 0ULL - magnitude;
+        }
+        char* start = formatDigits(end, magnitude);
+        if (negative) {
+            *--start = '-';
+        }
+        out.append(start, static_cast<size_t>(end - start));
+    }
+};
+
+// Characters print as themselves
+template<typename T>
+struct Formatter<T, typename std::enable_if<std::is_same<T, char>::value || std::is_same<T, signed char>::value ||
+                                            std::is_same<T, unsigned char>::value>::type> {
+    static const bool fast = true;
+
+    static void write(Writer& out, T value, std::streamsize) {
+        char character = static_cast<char>(value);
+        out.append(&character, 1);
+    }
+};
+
+// Default float formatting is printf's %g at the stream's precision
+template<typename T>
+struct Formatter<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+    static const bool fast = true;
+
+    static void write(Writer& out, T value, std::streamsize precision) {
+        char* start = out.reserve(maxNumberLength);
+        int length = std::is_same<T, long double>::value
+                         ? std::snprintf(start, maxNumberLength, "%.*Lg", static_cast<int>(precision),
+                                         static_cast<long double>(value))
+                         : std::snprintf(start, maxNumberLength, "%.*g", static_cast<int>(precision),
+                                         static_cast<double>(value));
+        out.commit(start + length);
+    }
+};
+
+template<>
+struct Formatter<std::string> {
+    static const bool fast = true;
+
+    static void write(Writer& out, const std::string& value, std::streamsize) {
+        out.append(value.data(), value.size());
+    }
+};
+
+// Prints [first, last) as "[a, b, c]", the output format of the containers
+template<typename T, typename Iter>
+void writeSequence(std::ostream& os, Iter first, Iter last, std::false_type) {
+    os << "[";
+    for (bool separate = false; first != last; ++first, separate = true) {
+        if (separate) os << ", ";
+        os << *first;
+    }
+    os << "]";
+}
+
+template<typename T, typename Iter>
+void writeSequence(std::ostream& os, Iter first, Iter last, std::true_type) {
+    if (!plainStream(os)) {
+        writeSequence<T>(os, first, last, std::false_type());
+        return;
+    }
+    std::streamsize precision = os.precision();
+    Writer out(os);
+    out.append("[", 1);
+    for (bool separate = false; first != last; ++first, separate = true) {
+        if (separate) out.append(", ", 2);
+        Formatter<T>::write(out, *first, precision);
+    }
+    out.append("]", 1);
+    out.flush();
+}
+
+template<typename T, typename Iter>
+std::ostream& writeSequence(std::ostream& os, Iter first, Iter last) {
+    writeSequence<T>(os, first, last, std::integral_constant<bool, Formatter<T>::fast>());
+    return os;
+}
+
+// How T is read back from a token, with surrounding whitespace already
+// removed. parse() returns false if the token is not exactly one T. Types
+// without a fast specialization are read with operator>>.
+template<typename T, typename Enable = void>
+struct Parser {
+    static bool parse(const char* first, const char* last, T& value) {
+        std::istringstream in(std::string(first, last));
+        in >> value;
+        return !in.fail() && (in >> std::ws).eof();
+    }
+};
+
+// Integers and bool (0 or 1), with overflow checking
+template<typename T>
+struct Parser<T, typename std::enable_if<std::is_integral<T>::value && !IsCharacter<T>::value>::type> {
+    static bool parse(const char* first, const char* last, T& value) {
+        bool negative = first != last && *first == '-';
+        if (first != last && (*first == '-' || *first == '+')) {
+            ++first;
+        }
+        if (first == last || (negative && !std::is_signed<T>::value)) {
+            return false;
+        }
+        // Largest magnitude allowed: max for positive values, max + 1 for negative
+        unsigned long long limit = static_cast<unsigned long long>(std::numeric_limits<T>::max()) + (negative ? 1 : 0);
+        unsigned long long magnitude = 0;
+        for (; first != last; ++first) {
+            unsigned digit = static_cast<unsigned>(*first - '0');
+            if (digit > 9 || digit > limit || magnitude > (limit - digit) / 10) {
+                return false;
+            }
+            magnitude = magnitude * 10 + digit;
+        }
+        value = negative ? static_cast<T>(0ULL - magnitude) : static_cast<T>(magnitude);
+        return true;
+    }
+};
+
+template<typename T>
+struct Parser<T, typename std::enable_if<std::is_same<T, char>::value || std::is_same<T, signed char>::value ||
+                                         std::is_same<T, unsigned char>::value>::type> {
+    static bool parse(const char* first, const char* last, T& value) {
+        if (last - first != 1) {
+            return false;
+        }
+        value = static_cast<T>(*first);
+        return true;
+    }
+};
+
+// strtod and friends, on a NUL-terminated copy of the token: on the stack
+// for the usual lengths, on the heap for longer ones. Overflow is an error,
+// as for integers; underflow yields the nearest representable value.
+template<typename T>
+struct Parser<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+    static bool parse(const char* first, const char* last, T& value) {
+        size_t length = static_cast<size_t>(last - first);
+        if (length == 0) {
+            return false;
+        }
+        char token[maxNumberLength];
+        std::string longToken;
+        char* copy = token;
+        if (length >= sizeof(token)) {
+            longToken.assign(first, last);
+            copy = &longToken[0];
+        } else {
+            std::memcpy(token, first, length);
+            token[length] = '\0';
+        }
+        char* end;
+        errno = 0;
+        if (std::is_same<T, float>::value) {
+            value = static_cast<T>(std::strtof(copy, &end));
+        } else if (std::is_same<T, double>::value) {
+            value = static_cast<T>(std::strtod(copy, &end));
+        } else {
+            value = static_cast<T>(std::strtold(copy, &end));
+        }
+        // Out of range comes back as +-HUGE_VAL; reject it like operator>> does
+        bool overflow = errno == ERANGE && (value == std::numeric_limits<T>::infinity() ||
+                                            value == -std::numeric_limits<T>::infinity());
+        return end == copy + length && !overflow;
+    }
+};
+
+template<>
+struct Parser<std::string> {
+    static bool parse(const char* first, const char* last, std::string& value) {
+        value.assign(first, last);
+        return true;
+    }
+};
+
+inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Appends the elements of [first, last) to elements. The text is either one
+// list as written by operator<<, "[a, b, c]", or elements separated by
+// commas or newlines, where blank fields are skipped. Whitespace around
+// elements is ignored, so strings with a delimiter or surrounding spaces do
+// not survive the trip. Delimiters are located with vector compares, and
+// elements are reserved once from their number. Throws
+// std::invalid_argument on malformed input; elements may then hold part of
+// the input.
+template<typename T, typename Storage>
+void parseSequence(const char* first, const char* last, Storage& elements) {
+    const char* p = first;
+    while (p != last && isSpace(*p)) ++p;
+    bool bracketed = p != last && *p == '[';
+    char end = bracketed ? ']' : '\n';
+    if (bracketed) ++p;
+    // Grows like push_back would, so repeated calls stay amortized O(1) per element
+    size_t needed = elements.size() + simd::countEither(p, static_cast<size_t>(last - p), ',', end) + 1;
+    if (needed > elements.capacity()) {
+        elements.reserve(std::max(needed, 2 * elements.capacity()));
+    }
+
+    bool closed = false;
+    for (bool firstField = true; p != last; firstField = false) {
+        const char* stop = p + simd::findEither(p, static_cast<size_t>(last - p), ',', end);
+        const char* tokenFirst = p;
+        const char* tokenLast = stop;
+        while (tokenFirst != tokenLast && isSpace(*tokenFirst)) ++tokenFirst;
+        while (tokenLast != tokenFirst && isSpace(tokenLast[-1])) --tokenLast;
+        closed = bracketed && stop != last && *stop == ']';
+        if (tokenFirst != tokenLast) {
+            T value;
+            if (!Parser<T>::parse(tokenFirst, tokenLast, value)) {
+                throw std::invalid_argument("Cannot parse element \"" + std::string(tokenFirst, tokenLast) +
+                                            "\" at offset " + std::to_string(tokenFirst - first));
+            }
+            elements.push_back(std::move(value));
+        } else if (bracketed && !(closed && firstField)) {
+            throw std::invalid_argument("Empty element at offset " + std::to_string(tokenFirst - first));
+        }
+        p = stop == last ? stop : stop + 1;
+        if (closed) {
+            break;
+        }
+    }
+    if (bracketed && !closed) {
+        throw std::invalid_argument("Missing ']' at end of input");
+    }
+    while (p != last && isSpace(*p)) ++p;
+    if (p != last) {
+        throw std::invalid_argument("Unexpected text after ']' at offset " + std::to_string(p - first));
+    }
+}
+
+// Whole contents of a file, read in one block
+inline std::string readFile(const std::string& path) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        throw std::system_error(errno, std::generic_category(), "Cannot open " + path);
+    }
+    std::string contents;
+    long size = -1;
+    if (std::fseek(file, 0, SEEK_END) == 0) {
+        size = std::ftell(file);
+        std::fseek(file, 0, SEEK_SET);
+    }
+    if (size > 0) {
+        contents.resize(static_cast<size_t>(size));
+        contents.resize(std::fread(&contents[0], 1, contents.size(), file));
+    }
+    // Streams whose size is unknown, and anything appended meanwhile
+    char block[4096];
+    for (size_t got; (got = std::fread(block, 1, sizeof(block), file)) > 0;) {
+        contents.append(block, got);
+    }
+    bool failed = std::ferror(file) != 0;
+    std::fclose(file);
+    if (failed) {
+        throw std::system_error(EIO, std::generic_category(), "Cannot read " + path);
+    }
+    return contents;
+}
+
+} // namespace text
+} // namespace mycontainers
+
+#endif // TEXTFORMAT_HPP
@@ -0,0 +1,780 @@
+// tomergal40@gmail.com
+// Benchmarks for MyContainer: run with "make bench", or build Benchmark and
+// pass --help for the options. Every measurement prints one human-readable
+// row and, with --csv, one machine-readable CSV line for regression tracking.
+#include "MyContainer.hpp"
+#include "Arena.hpp"
+#include "SmallMyContainer.hpp"
+#include "ConcurrentMyContainer.hpp"
+#include "MappedMyContainer.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace mycontainers;
+
+// Allocation counting: every global operator new bumps the counter
+static std::atomic<unsigned long long> allocationCount(0);
+
+// Kept out of line so the compiler does not pair malloc/free with new/delete
+__attribute__((noinline)) static void* countedAllocate(std::size_t size) {
+    allocationCount++;
+    void* p = std::malloc(size == 0 ? 1 : size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+__attribute__((noinline)) static void countedRelease(void* p) {
+    std::free(p);
+}
+
+void* operator new(std::size_t size) { return countedAllocate(size); }
+void* operator new[](std::size_t size) { return countedAllocate(size); }
+void operator delete(void* p) noexcept { countedRelease(p); }
+void operator delete[](void* p) noexcept { countedRelease(p); }
+void operator delete(void* p, std::size_t) noexcept { countedRelease(p); }
+void operator delete[](void* p, std::size_t) noexcept { countedRelease(p); }
+
+namespace {
+
+struct Options {
+    size_t minSize = 1000;
+    size_t maxSize = 1000000;
+    std::string suite;     // empty runs every suite
+    std::string csvPath;
+};
+
+// Collects one row per measurement
+class Reporter {
+private:
+    std::ofstream csv;
+
+public:
+    explicit Reporter(const std::string& csvPath) {
+        if (!csvPath.empty()) {
+            csv.open(csvPath.c_str());
+            if (!csv) {
+                throw std::runtime_error("Cannot open " + csvPath);
+            }
+            csv << "suite,type,distribution,size,operation,ns_per_element,total_ms,allocations\n";
+        }
+        std::cout << std::left << std::setw(12) << "suite" << std::setw(8) << "type"
+                  << std::setw(11) << "dist" << std::right << std::setw(11) << "size" << "  "
+                  << std::left << std::setw(26) << "operation" << std::right
+                  << std::setw(12) << "ns/elem" << std::setw(12) << "total ms"
+                  << std::setw(10) << "allocs" << std::endl;
+    }
+
+    void row(const std::string& suite, const std::string& type, const std::string& distribution,
+             size_t size, const std::string& operation, double seconds, unsigned long long allocations) {
+        double nsPerElement = size ? seconds * 1e9 / static_cast<double>(size) : 0.0;
+        std::cout << std::left << std::setw(12) << suite << std::setw(8) << type
+                  << std::setw(11) << distribution << std::right << std::setw(11) << size << "  "
+                  << std::left << std::setw(26) << operation << std::right << std::fixed
+                  << std::setprecision(2) << std::setw(12) << nsPerElement
+                  << std::setw(12) << seconds * 1e3 << std::setw(10) << allocations << std::endl;
+        if (csv.is_open()) {
+            csv << suite << ',' << type << ',' << distribution << ',' << size << ',' << operation << ','
+                << nsPerElement << ',' << seconds * 1e3 << ',' << allocations << '\n';
+        }
+    }
+};
+
+// Measures wall time and allocations of a scope
+class Stopwatch {
+private:
+    std::chrono::steady_clock::time_point start;
+    unsigned long long startAllocations;
+
+public:
+    Stopwatch() : start(std::chrono::steady_clock::now()), startAllocations(allocationCount.load()) {}
+
+    double seconds() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    unsigned long long allocations() const {
+        return allocationCount.load() - startAllocations;
+    }
+};
+
+// Keeps traversal results observable so the loops are not optimized away
+volatile unsigned long long sink = 0;
+
+void consume(int value) { sink += static_cast<unsigned long long>(value); }
+void consume(double value) { sink += static_cast<unsigned long long>(value); }
+void consume(const std::string& value) { sink += value.size(); }
+
+template<typename T> struct TypeName;
+template<> struct TypeName<int> { static const char* get() { return "int"; } };
+template<> struct TypeName<double> { static const char* get() { return "double"; } };
+template<> struct TypeName<std::string> { static const char* get() { return "string"; } };
+
+template<typename T> T makeValue(unsigned long long key);
+template<> int makeValue<int>(unsigned long long key) { return static_cast<int>(key % 2147483647ull); }
+template<> double makeValue<double>(unsigned long long key) { return static_cast<double>(key % 1000000007ull) / 7.0; }
+template<> std::string makeValue<std::string>(unsigned long long key) { return "key" + std::to_string(key); }
+
+const char* const distributions[] = {"random", "sorted", "reversed", "duplicates"};
+
+// Element keys for the given distribution; keys are offset to a fixed width
+// so that "sorted" also holds lexicographically for strings
+template<typename T>
+std::vector<T> makeInput(const std::string& distribution, size_t size) {
+    std::mt19937_64 rng(42);
+    std::vector<unsigned long long> keys(size);
+    for (size_t i = 0; i < size; ++i) {
+        if (distribution == "random") keys[i] = rng() % 1000000000ull;
+        else if (distribution == "sorted") keys[i] = i;
+        else if (distribution == "reversed") keys[i] = size - i;
+        else keys[i] = rng() % 16;
+    }
+    std::vector<T> values;
+    values.reserve(size);
+    for (size_t i = 0; i < size; ++i) {
+        values.push_back(makeValue<T>(keys[i] + 1000000000000ull));
+    }
+    return values;
+}
+
+// Times one order on a fresh copy of base (so sorted orders pay for their
+// sort): the factory call, one full traversal, and both together
+template<typename T, typename Factory>
+void timeOrder(Reporter& reporter, const char* type, const char* distribution,
+               const std::string& name, const MyContainer<T>& base, Factory factory) {
+    MyContainer<T> fresh = base;
+    size_t size = fresh.size();
+
+    Stopwatch total;
+    Stopwatch construction;
+    auto view = factory(fresh);
+    double constructionSeconds = construction.seconds();
+    unsigned long long constructionAllocations = construction.allocations();
+
+    Stopwatch traversal;
+    for (auto it = view.begin(); it != view.end(); ++it) {
+        consume(*it);
+    }
+    double traversalSeconds = traversal.seconds();
+    unsigned long long traversalAllocations = traversal.allocations();
+    double totalSeconds = total.seconds();
+    unsigned long long totalAllocations = total.allocations();
+
+    reporter.row("orders", type, distribution, size, name + ".construct", constructionSeconds, constructionAllocations);
+    reporter.row("orders", type, distribution, size, name + ".traverse", traversalSeconds, traversalAllocations);
+    reporter.row("orders", type, distribution, size, name + ".total", totalSeconds, totalAllocations);
+}
+
+// add(), tryRemove() and the six orders for every distribution and size
+template<typename T>
+void benchContainer(const Options& options, Reporter& reporter) {
+    const char* type = TypeName<T>::get();
+    for (const char* distribution : distributions) {
+        for (size_t size = options.minSize; size <= options.maxSize; size *= 10) {
+            std::vector<T> input = makeInput<T>(distribution, size);
+
+            MyContainer<T> base;
+            {
+                Stopwatch watch;
+                for (const T& value : input) {
+                    base.add(value);
+                }
+                reporter.row("container", type, distribution, size, "add", watch.seconds(), watch.allocations());
+            }
+            {
+                // Average of removing a sample of present values, one pass each
+                MyContainer<T> copy = base;
+                size_t removals = std::min<size_t>(16, size);
+                Stopwatch watch;
+                for (size_t i = 0; i < removals; ++i) {
+                    copy.tryRemove(input[i * (size / removals)]);
+                }
+                reporter.row("container", type, distribution, size, "tryRemove.avg",
+                             watch.seconds() / removals, watch.allocations() / removals);
+            }
+
+            typedef MyContainer<T> C;
+            timeOrder(reporter, type, distribution, "ascending", base, [](const C& c) { return c.ascending(); });
+            timeOrder(reporter, type, distribution, "descending", base, [](const C& c) { return c.descending(); });
+            timeOrder(reporter, type, distribution, "sideCross", base, [](const C& c) { return c.sideCross(); });
+            timeOrder(reporter, type, distribution, "reverse", base, [](const C& c) { return c.reverse(); });
+            timeOrder(reporter, type, distribution, "order", base, [](const C& c) { return c.order(); });
+            timeOrder(reporter, type, distribution, "middleOut", base, [](const C& c) { return c.middleOut(); });
+        }
+    }
+}
+
+void benchOrders(const Options& options, Reporter& reporter) {
+    benchContainer<int>(options, reporter);
+    benchContainer<double>(options, reporter);
+    benchContainer<std::string>(options, reporter);
+}
+
+// Builds the sorted index with each algorithm at sizes growing 4x from 16,
+// to locate the size where radix sort overtakes comparison sort and where
+// sorting on every hardware thread starts to pay off
+template<typename T>
+void benchSortAlgorithms(const Options& options, Reporter& reporter) {
+    const char* type = TypeName<T>::get();
+    const struct {
+        const char* name;
+        SortAlgorithm algorithm;
+        unsigned threads;
+    } algorithms[] = {
+        {"sort.comparison", SortAlgorithm::Comparison, 1},
+        {"sort.radix", SortAlgorithm::Radix, 1},
+        {"sort.comparison.parallel", SortAlgorithm::Comparison, 0},
+        {"sort.radix.parallel", SortAlgorithm::Radix, 0},
+    };
+    for (size_t size = 16; size <= options.maxSize; size *= 4) {
+        std::vector<T> input = makeInput<T>("random", size);
+        // Small sizes are repeated so that each row covers enough work to time
+        size_t repeats = std::max<size_t>(1, 1000000 / size);
+        for (const auto& entry : algorithms) {
+            std::vector<MyContainer<T> > containers(repeats);
+            for (MyContainer<T>& container : containers) {
+                container.setSortAlgorithm(entry.algorithm);
+                container.setSortThreads(entry.threads);
+                for (const T& value : input) {
+                    container.add(value);
+                }
+            }
+            Stopwatch watch;
+            for (const MyContainer<T>& container : containers) {
+                consume(*container.ascending().begin());
+            }
+            reporter.row("sort", type, "random", size, entry.name,
+                         watch.seconds() / repeats, watch.allocations() / repeats);
+        }
+    }
+}
+
+void benchSort(const Options& options, Reporter& reporter) {
+    benchSortAlgorithms<int>(options, reporter);
+    benchSortAlgorithms<double>(options, reporter);
+}
+
+// count(), contains() of a missing value and tryRemove() of a rare value at
+// every SIMD level, on containers without a membership index
+template<typename T>
+void benchSearchLevels(const Options& options, Reporter& reporter, const char* type) {
+    const struct {
+        const char* name;
+        simd::Level level;
+    } levels[] = {
+        {"scalar", simd::Level::Scalar},
+        {"sse4.1", simd::Level::Sse41},
+        {"avx2", simd::Level::Avx2},
+    };
+    for (size_t size = options.minSize; size <= options.maxSize; size *= 10) {
+        MyContainer<T> base;
+        for (size_t i = 0; i < size; ++i) {
+            base.add(static_cast<T>(i % 1000));
+        }
+        for (const auto& entry : levels) {
+            simd::setLevel(entry.level);
+            if (simd::activeLevel() != entry.level) {
+                continue;
+            }
+            std::string level = entry.name;
+            {
+                Stopwatch watch;
+                consume(static_cast<int>(base.count(static_cast<T>(7))));
+                reporter.row("search", type, "cyclic", size, "count." + level, watch.seconds(), watch.allocations());
+            }
+            {
+                Stopwatch watch;
+                consume(static_cast<int>(base.contains(static_cast<T>(-1))));
+                reporter.row("search", type, "cyclic", size, "contains.miss." + level, watch.seconds(), watch.allocations());
+            }
+            {
+                MyContainer<T> copy = base;
+                Stopwatch watch;
+                consume(static_cast<int>(copy.tryRemove(static_cast<T>(7))));
+                reporter.row("search", type, "cyclic", size, "tryRemove." + level, watch.seconds(), watch.allocations());
+            }
+        }
+        simd::setLevel(simd::detectedLevel());
+    }
+}
+
+void benchSearch(const Options& options, Reporter& reporter) {
+    benchSearchLevels<int>(options, reporter, "int");
+    benchSearchLevels<long long>(options, reporter, "int64");
+    benchSearchLevels<float>(options, reporter, "float");
+    benchSearchLevels<double>(options, reporter, "double");
+}
+
+// One simulated request: fill a short-lived container, traverse its
+// ascending and sideCross orders, and drop it
+template<typename Container>
+void serveRequest(Container& container, const std::vector<int>& input) {
+    container.addRange(input.begin(), input.end());
+    auto ascending = container.ascending();
+    for (auto it = ascending.begin(); it != ascending.end(); ++it) {
+        consume(*it);
+    }
+    auto sideCross = container.sideCross();
+    consume(*sideCross.begin());
+}
+
+// Per-request cost with the default heap and with a MonotonicArena that is
+// reset after every request
+void benchArena(const Options& options, Reporter& reporter) {
+    const size_t requests = 100;
+    for (size_t size = options.minSize; size <= options.maxSize; size *= 10) {
+        std::vector<int> input = makeInput<int>("random", size);
+        {
+            Stopwatch watch;
+            for (size_t r = 0; r < requests; ++r) {
+                MyContainer<int> container;
+                serveRequest(container, input);
+            }
+            reporter.row("arena", "int", "random", size, "request.heap",
+                         watch.seconds() / requests, watch.allocations() / requests);
+        }
+        {
+            MonotonicArena arena;
+            // Warm-up request, so the arena's blocks already exist
+            {
+                MyContainer<int, ArenaAllocator<int> > container{ArenaAllocator<int>(arena)};
+                serveRequest(container, input);
+            }
+            arena.reset();
+            Stopwatch watch;
+            for (size_t r = 0; r < requests; ++r) {
+                {
+                    MyContainer<int, ArenaAllocator<int> > container{ArenaAllocator<int>(arena)};
+                    serveRequest(container, input);
+                }
+                arena.reset();
+            }
+            reporter.row("arena", "int", "random", size, "request.arena",
+                         watch.seconds() / requests, watch.allocations() / requests);
+        }
+    }
+}
+
+template<typename View>
+void traverse(const View& view) {
+    for (auto it = view.begin(); it != view.end(); ++it) {
+        consume(*it);
+    }
+}
+
+// Fills a container of the given size and walks all six orders
+template<typename Container>
+void fillAndTraverse(const std::vector<int>& input) {
+    Container container;
+    for (int value : input) {
+        container.add(value);
+    }
+    traverse(container.ascending());
+    traverse(container.descending());
+    traverse(container.sideCross());
+    traverse(container.reverse());
+    traverse(container.order());
+    traverse(container.middleOut());
+}
+
+// Tiny containers end to end: MyContainer against SmallMyContainer<int, 16>
+void benchSmall(const Options&, Reporter& reporter) {
+    const size_t repeats = 100000;
+    const size_t sizes[] = {1, 4, 8, 16, 32};
+    for (size_t size : sizes) {
+        std::vector<int> input = makeInput<int>("random", size);
+        {
+            Stopwatch watch;
+            for (size_t r = 0; r < repeats; ++r) {
+                fillAndTraverse<MyContainer<int> >(input);
+            }
+            reporter.row("small", "int", "random", size, "sixOrders.MyContainer",
+                         watch.seconds() / repeats, watch.allocations() / repeats);
+        }
+        {
+            Stopwatch watch;
+            for (size_t r = 0; r < repeats; ++r) {
+                fillAndTraverse<SmallMyContainer<int, 16> >(input);
+            }
+            reporter.row("small", "int", "random", size, "sixOrders.Small16",
+                         watch.seconds() / repeats, watch.allocations() / repeats);
+        }
+    }
+}
+
+// Runs work(worker) on threads workers and waits for all of them
+template<typename Work>
+void runThreads(unsigned threads, Work work) {
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back(work, t);
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+// add() throughput from 1 to 64 threads: MyContainer behind one global
+// mutex against ConcurrentMyContainer, then a snapshot traversal of the
+// result. Each row covers --max-size adds split evenly over the threads.
+void benchConcurrent(const Options& options, Reporter& reporter) {
+    const size_t total = options.maxSize;
+    for (unsigned threads = 1; threads <= 64; threads *= 2) {
+        size_t perThread = total / threads;
+        std::string suffix = ".t" + std::to_string(threads);
+        {
+            MyContainer<int> container;
+            std::mutex lock;
+            Stopwatch watch;
+            runThreads(threads, [&container, &lock, perThread](unsigned t) {
+                for (size_t i = 0; i < perThread; ++i) {
+                    std::lock_guard<std::mutex> guard(lock);
+                    container.add(static_cast<int>(t * perThread + i));
+                }
+            });
+            reporter.row("concurrent", "int", "threads", perThread * threads, "add.globalMutex" + suffix,
+                         watch.seconds(), watch.allocations());
+        }
+        {
+            ConcurrentMyContainer<int> container(threads);
+            Stopwatch addWatch;
+            runThreads(threads, [&container, perThread](unsigned t) {
+                for (size_t i = 0; i < perThread; ++i) {
+                    container.add(static_cast<int>(t * perThread + i));
+                }
+            });
+            reporter.row("concurrent", "int", "threads", perThread * threads, "add.sharded" + suffix,
+                         addWatch.seconds(), addWatch.allocations());
+
+            Stopwatch watch;
+            consume(*container.ascending().begin());
+            reporter.row("concurrent", "int", "threads", perThread * threads, "ascending.sharded" + suffix,
+                         watch.seconds(), watch.allocations());
+        }
+    }
+}
+
+// Fan-out: copying a sorted container, traversing the copy, and the first
+// change to the copy, with deep copies and with copy-on-write sharing
+template<typename T>
+void benchCopyModes(const Options& options, Reporter& reporter) {
+    const char* type = TypeName<T>::get();
+    const struct {
+        const char* name;
+        bool copyOnWrite;
+    } modes[] = {
+        {"deep", false},
+        {"cow", true},
+    };
+    for (size_t size = options.minSize; size <= options.maxSize; size *= 10) {
+        std::vector<T> input = makeInput<T>("random", size);
+        for (const auto& mode : modes) {
+            MyContainer<T> base;
+            base.setCopyOnWrite(mode.copyOnWrite);
+            base.addRange(input.begin(), input.end());
+            consume(*base.ascending().begin());
+            std::string name = mode.name;
+
+            Stopwatch copyWatch;
+            MyContainer<T> copy(base);
+            reporter.row("copy", type, "random", size, "copy." + name, copyWatch.seconds(), copyWatch.allocations());
+
+            Stopwatch traverseWatch;
+            auto ascending = copy.ascending();
+            for (auto it = ascending.begin(); it != ascending.end(); ++it) {
+                consume(*it);
+            }
+            reporter.row("copy", type, "random", size, "ascending." + name,
+                         traverseWatch.seconds(), traverseWatch.allocations());
+
+            Stopwatch writeWatch;
+            copy.add(input[0]);
+            reporter.row("copy", type, "random", size, "firstAdd." + name, writeWatch.seconds(), writeWatch.allocations());
+        }
+    }
+}
+
+void benchCopy(const Options& options, Reporter& reporter) {
+    benchCopyModes<int>(options, reporter);
+    benchCopyModes<std::string>(options, reporter);
+}
+
+// Checkpointing: save() and load() of the binary format, against writing
+// the same container as text with operator<<
+template<typename T>
+void benchBinaryType(const Options& options, Reporter& reporter) {
+    const char* type = TypeName<T>::get();
+    const std::string path = "bench_binary.bin";
+    for (size_t size = options.minSize; size <= options.maxSize; size *= 10) {
+        MyContainer<T> container;
+        std::vector<T> input = makeInput<T>("random", size);
+        container.addRange(input.begin(), input.end());
+        {
+            Stopwatch watch;
+            std::ofstream out(path.c_str());
+            out << container;
+            out.close();
+            reporter.row("binary", type, "random", size, "save.text", watch.seconds(), watch.allocations());
+        }
+        {
+            Stopwatch watch;
+            container.save(path);
+            reporter.row("binary", type, "random", size, "save.binary", watch.seconds(), watch.allocations());
+        }
+        {
+            Stopwatch watch;
+            MyContainer<T> loaded = MyContainer<T>::load(path);
+            reporter.row("binary", type, "random", size, "load.binary", watch.seconds(), watch.allocations());
+            consume(*loaded.order().begin());
+        }
+        std::remove(path.c_str());
+    }
+}
+
+void benchBinary(const Options& options, Reporter& reporter) {
+    benchBinaryType<int>(options, reporter);
+    benchBinaryType<double>(options, reporter);
+    benchBinaryType<std::string>(options, reporter);
+}
+
+// Stream buffer that only counts characters, so formatting is measured
+// without the cost of storing the text
+class CountingBuffer : public std::streambuf {
+public:
+    unsigned long long characters = 0;
+
+protected:
+    int_type overflow(int_type c) override {
+        characters++;
+        return traits_type::not_eof(c);
+    }
+
+    std::streamsize xsputn(const char*, std::streamsize count) override {
+        characters += static_cast<unsigned long long>(count);
+        return count;
+    }
+};
+
+// Text output: every element through the stream as operator<< used to do,
+// against operator<< and printAscending()
+template<typename T>
+void benchTextType(const Options& options, Reporter& reporter) {
+    const char* type = TypeName<T>::get();
+    for (size_t size = options.minSize; size <= options.maxSize; size *= 10) {
+        std::vector<T> input = makeInput<T>("random", size);
+        MyContainer<T> container;
+        container.addRange(input.begin(), input.end());
+        consume(*container.ascending().begin());
+        CountingBuffer buffer;
+        std::ostream os(&buffer);
+        {
+            Stopwatch watch;
+            os << "[";
+            for (size_t i = 0; i < input.size(); ++i) {
+                if (i > 0) os << ", ";
+                os << input[i];
+            }
+            os << "]";
+            reporter.row("text", type, "random", size, "print.perElement", watch.seconds(), watch.allocations());
+        }
+        {
+            Stopwatch watch;
+            os << container;
+            reporter.row("text", type, "random", size, "print.chunked", watch.seconds(), watch.allocations());
+        }
+        {
+            Stopwatch watch;
+            container.printAscending(os);
+            reporter.row("text", type, "random", size, "printAscending", watch.seconds(), watch.allocations());
+        }
+        sink += buffer.characters;
+    }
+}
+
+void benchText(const Options& options, Reporter& reporter) {
+    benchTextType<int>(options, reporter);
+    benchTextType<double>(options, reporter);
+    benchTextType<std::string>(options, reporter);
+}
+
+// Text input: one add() per value read with operator>>, as loaders did
+// before, against parse() of a printed list and of newline-separated text
+template<typename T>
+void benchParseType(const Options& options, Reporter& reporter) {
+    const char* type = TypeName<T>::get();
+    for (size_t size = options.minSize; size <= options.maxSize; size *= 10) {
+        std::vector<T> input = makeInput<T>("random", size);
+        MyContainer<T> source;
+        source.addRange(input.begin(), input.end());
+        std::ostringstream printed, lines;
+        printed << std::setprecision(17) << source;
+        lines << std::setprecision(17);
+        for (const T& value : input) {
+            lines << value << '\n';
+        }
+        {
+            Stopwatch watch;
+            std::istringstream in(lines.str());
+            MyContainer<T> container;
+            T value;
+            while (in >> value) {
+                container.add(value);
+            }
+            reporter.row("parse", type, "random", size, "parse.istream", watch.seconds(), watch.allocations());
+            sink += container.size();
+        }
+        {
+            Stopwatch watch;
+            MyContainer<T> container = MyContainer<T>::parse(printed.str());
+            reporter.row("parse", type, "random", size, "parse.list", watch.seconds(), watch.allocations());
+            sink += container.size();
+        }
+        {
+            Stopwatch watch;
+            MyContainer<T> container = MyContainer<T>::parse(lines.str());
+            reporter.row("parse", type, "random", size, "parse.lines", watch.seconds(), watch.allocations());
+            sink += container.size();
+        }
+    }
+}
+
+void benchParse(const Options& options, Reporter& reporter) {
+    benchParseType<int>(options, reporter);
+    benchParseType<double>(options, reporter);
+    benchParseType<std::string>(options, reporter);
+}
+
+// The file-backed container against the in-memory one: add(), a traversal
+// in insertion order, reopening the file, and the sorted order in and out
+// of memory
+void benchMapped(const Options& options, Reporter& reporter) {
+    const std::string path = "bench_mapped.bin";
+    for (size_t size = options.minSize; size <= options.maxSize; size *= 10) {
+        {
+            MyContainer<long long> memory;
+            Stopwatch watch;
+            for (size_t i = 0; i < size; ++i) {
+                memory.add(static_cast<long long>(i));
+            }
+            reporter.row("mapped", "int64", "sorted", size, "add.memory", watch.seconds(), watch.allocations());
+        }
+        std::remove(path.c_str());
+        {
+            MappedMyContainer<long long> mapped(path);
+            Stopwatch watch;
+            for (size_t i = 0; i < size; ++i) {
+                mapped.add(static_cast<long long>(i));
+            }
+            reporter.row("mapped", "int64", "sorted", size, "add.mapped", watch.seconds(), watch.allocations());
+        }
+        {
+            Stopwatch watch;
+            MappedMyContainer<long long> reopened(path);
+            reporter.row("mapped", "int64", "sorted", size, "reopen.mapped", watch.seconds(), watch.allocations());
+
+            Stopwatch traversal;
+            auto order = reopened.order();
+            for (auto it = order.begin(); it != order.end(); ++it) {
+                consume(static_cast<double>(*it));
+            }
+            reporter.row("mapped", "int64", "sorted", size, "order.mapped", traversal.seconds(), traversal.allocations());
+        }
+        // Ascending order sorted in memory, then externally in eight runs
+        std::remove(path.c_str());
+        {
+            MappedMyContainer<long long> mapped(path);
+            for (size_t i = 0; i < size; ++i) {
+                mapped.add(static_cast<long long>((i * 2654435761u) % size));
+            }
+            for (size_t runs = 1; runs <= 8; runs *= 8) {
+                mapped.setSortMemoryBudget(size * sizeof(long long) / runs);
+                Stopwatch watch;
+                auto ascending = mapped.ascending();
+                for (auto it = ascending.begin(); it != ascending.end(); ++it) {
+                    consume(static_cast<double>(*it));
+                }
+                reporter.row("mapped", "int64", "random", size, runs == 1 ? "ascending.memory" : "ascending.external",
+                             watch.seconds(), watch.allocations());
+            }
+        }
+        std::remove(path.c_str());
+    }
+}
+
+const struct {
+    const char* name;
+    void (*run)(const Options&, Reporter&);
+} suites[] = {
+    {"orders", benchOrders},
+    {"sort", benchSort},
+    {"search", benchSearch},
+    {"arena", benchArena},
+    {"small", benchSmall},
+    {"concurrent", benchConcurrent},
+    {"copy", benchCopy},
+    {"mapped", benchMapped},
+    {"binary", benchBinary},
+    {"text", benchText},
+    {"parse", benchParse},
+};
+
+void usage() {
+    std::cout << "Usage: Benchmark [--suite NAME] [--min-size N] [--max-size N] [--csv PATH]\n"
+              << "Sizes grow by 10x from --min-size (default 1000) to --max-size (default 1000000).\n"
+              << "Suites:";
+    for (const auto& suite : suites) {
+        std::cout << ' ' << suite.name;
+    }
+    std::cout << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--suite" && hasValue) options.suite = argv[++i];
+        else if (arg == "--min-size" && hasValue) options.minSize = static_cast<size_t>(std::atof(argv[++i]));
+        else if (arg == "--max-size" && hasValue) options.maxSize = static_cast<size_t>(std::atof(argv[++i]));
+        else if (arg == "--csv" && hasValue) options.csvPath = argv[++i];
+        else {
+            usage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+    if (options.minSize == 0) {
+        options.minSize = 1;
+    }
+
+    try {
+        Reporter reporter(options.csvPath);
+        bool found = false;
+        for (const auto& suite : suites) {
+            if (options.suite.empty() || options.suite == suite.name) {
+                suite.run(options, reporter);
+                found = true;
+            }
+        }
+        if (!found) {
+            usage();
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Benchmark failed: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
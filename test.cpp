@@ -2,8 +2,18 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest.h"
 #include "MyContainer.hpp"
+#include "Arena.hpp"
+#include "SmallMyContainer.hpp"
+#include "ConcurrentMyContainer.hpp"
+#include "MappedMyContainer.hpp"
 #include <vector>
 #include <string>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <thread>
+#include <atomic>
+#include <cstdio>
 
 using namespace mycontainers;
 
@@ -369,4 +379,1469 @@ TEST_CASE("Assignment Example Validation") {
         }
         CHECK(middleResult == std::vector<int>({6, 15, 1, 7, 2}));
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Iterators Are Views Over Container Storage") {
+    MyContainer<std::string> container;
+    container.add("pear");
+    container.add("apple");
+    container.add("fig");
+    
+    SUBCASE("All orders reference the same elements") {
+        auto orderIter = container.order();
+        auto it = orderIter.begin();
+        const std::string* pear = &*it;
+        const std::string* apple = &*(++it);
+        const std::string* fig = &*(++it);
+        
+        auto ascIter = container.ascending();
+        CHECK(&*ascIter.begin() == apple);
+        
+        auto descIter = container.descending();
+        CHECK(&*descIter.begin() == pear);
+        
+        auto revIter = container.reverse();
+        CHECK(&*revIter.begin() == fig);
+        
+        auto middleIter = container.middleOut();
+        CHECK(&*middleIter.begin() == apple);
+    }
+}
+
+TEST_CASE("Iterator Copies Share Order But Not Position") {
+    MyContainer<int> container;
+    container.add(7);
+    container.add(15);
+    container.add(6);
+    container.add(1);
+    container.add(2);
+    
+    SUBCASE("Advancing a copy leaves the original in place") {
+        auto iter = container.sideCross();
+        auto first = iter.begin();
+        auto second = first;
+        ++second;
+        
+        CHECK(*first == 1);
+        CHECK(*second == 15);
+        CHECK(first != second);
+    }
+    
+    SUBCASE("A view can be traversed repeatedly") {
+        auto iter = container.descending();
+        std::vector<int> firstPass, secondPass;
+        for (auto it = iter.begin(); it != iter.end(); ++it) {
+            firstPass.push_back(*it);
+        }
+        for (auto it = iter.begin(); it != iter.end(); ++it) {
+            secondPass.push_back(*it);
+        }
+        
+        CHECK(firstPass == std::vector<int>({15, 7, 6, 2, 1}));
+        CHECK(secondPass == firstPass);
+    }
+}
+
+TEST_CASE("Sorted Index Cache") {
+    MyContainer<int> container;
+    container.add(4);
+    container.add(2);
+    container.add(9);
+    
+    SUBCASE("Repeated sorted traversals reuse the index") {
+        container.ascending();
+        container.ascending();
+        container.sideCross();
+        
+        CHECK(container.cacheStats().misses == 1);
+        CHECK(container.cacheStats().hits == 2);
+    }
+    
+    SUBCASE("All sorted orders share one sort") {
+        container.ascending();
+        container.descending();
+        container.sideCross();
+        
+        CHECK(container.cacheStats().misses == 1);
+        CHECK(container.cacheStats().hits == 2);
+    }
+    
+    SUBCASE("SideCross over an even number of elements") {
+        container.add(7);
+        
+        std::vector<int> actual;
+        auto sideIter = container.sideCross();
+        for (auto it = sideIter.begin(); it != sideIter.end(); ++it) {
+            actual.push_back(*it);
+        }
+        CHECK(actual == std::vector<int>({2, 9, 4, 7}));
+    }
+    
+    SUBCASE("add() and remove() invalidate the index") {
+        container.ascending();
+        container.add(1);
+        
+        std::vector<int> actual;
+        auto ascIter = container.ascending();
+        for (auto it = ascIter.begin(); it != ascIter.end(); ++it) {
+            actual.push_back(*it);
+        }
+        CHECK(actual == std::vector<int>({1, 2, 4, 9}));
+        CHECK(container.cacheStats().misses == 2);
+        
+        container.remove(4);
+        actual.clear();
+        ascIter = container.ascending();
+        for (auto it = ascIter.begin(); it != ascIter.end(); ++it) {
+            actual.push_back(*it);
+        }
+        CHECK(actual == std::vector<int>({1, 2, 9}));
+        CHECK(container.cacheStats().misses == 3);
+        CHECK(container.cacheStats().hits == 0);
+    }
+    
+    SUBCASE("A failed remove() keeps the index") {
+        container.ascending();
+        CHECK_THROWS_AS(container.remove(100), std::invalid_argument);
+        container.ascending();
+        
+        CHECK(container.cacheStats().hits == 1);
+    }
+    
+    SUBCASE("Concurrent const readers share one sort") {
+        for (int i = 0; i < 5000; ++i) container.add((i * 7919) % 1013);
+        const MyContainer<int>& reader = container;
+        std::vector<int> firsts(4);
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < firsts.size(); ++t) {
+            threads.emplace_back([&reader, &firsts, t]() {
+                firsts[t] = *reader.ascending().begin();
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        CHECK(firsts == std::vector<int>(4, 0));
+        CHECK(container.cacheStats().misses == 1);
+        CHECK(container.cacheStats().hits == 3);
+    }
+}
+
+TEST_CASE("MiddleOut Order For Every Size") {
+    // Reference: middle first, then alternate left/right while both sides
+    // have elements left, then finish whichever side remains
+    for (int n = 1; n <= 12; ++n) {
+        MyContainer<int> container;
+        for (int i = 0; i < n; ++i) {
+            container.add(i);
+        }
+        
+        std::vector<int> expected;
+        int middle = n / 2;
+        expected.push_back(middle);
+        int left = middle - 1, right = middle + 1;
+        bool takeLeft = true;
+        while (static_cast<int>(expected.size()) < n) {
+            if ((takeLeft && left >= 0) || right >= n) {
+                expected.push_back(left--);
+            } else {
+                expected.push_back(right++);
+            }
+            takeLeft = !takeLeft;
+        }
+        
+        std::vector<int> actual;
+        auto middleIter = container.middleOut();
+        for (auto it = middleIter.begin(); it != middleIter.end(); ++it) {
+            actual.push_back(*it);
+        }
+        CHECK(actual == expected);
+    }
+}
+
+TEST_CASE("Incremental Sort On Append") {
+    MyContainer<int> container;
+    container.setIncrementalSort(true);
+    container.add(8);
+    container.add(3);
+    container.add(5);
+    container.ascending();
+    
+    SUBCASE("Appended elements are merged into the sorted index") {
+        container.add(4);
+        container.add(3);
+        container.add(10);
+        
+        std::vector<int> actual;
+        auto ascIter = container.ascending();
+        for (auto it = ascIter.begin(); it != ascIter.end(); ++it) {
+            actual.push_back(*it);
+        }
+        CHECK(actual == std::vector<int>({3, 3, 4, 5, 8, 10}));
+        CHECK(container.cacheStats().misses == 2);
+        CHECK(container.cacheStats().merges == 1);
+    }
+    
+    SUBCASE("remove() forces a full sort") {
+        container.add(1);
+        container.remove(8);
+        
+        std::vector<int> actual;
+        auto descIter = container.descending();
+        for (auto it = descIter.begin(); it != descIter.end(); ++it) {
+            actual.push_back(*it);
+        }
+        CHECK(actual == std::vector<int>({5, 3, 1}));
+        CHECK(container.cacheStats().merges == 0);
+    }
+    
+    SUBCASE("Merged order matches a full sort") {
+        MyContainer<int> reference;
+        for (int i = 0; i < 200; ++i) {
+            int value = (i * 37) % 23;
+            container.add(value);
+            reference.add(value);
+            if (i % 50 == 0) {
+                container.sideCross();
+            }
+        }
+        reference.add(8);
+        reference.add(3);
+        reference.add(5);
+        
+        std::vector<int> merged, full;
+        auto mergedIter = container.ascending();
+        for (auto it = mergedIter.begin(); it != mergedIter.end(); ++it) {
+            merged.push_back(*it);
+        }
+        auto fullIter = reference.ascending();
+        for (auto it = fullIter.begin(); it != fullIter.end(); ++it) {
+            full.push_back(*it);
+        }
+        CHECK(merged == full);
+        CHECK(container.cacheStats().merges == 5);
+    }
+}
+
+TEST_CASE("Lazy Sorted Orders") {
+    MyContainer<int> container;
+    for (int i = 0; i < 300; ++i) {
+        container.add((i * 71) % 97);
+    }
+    
+    std::vector<int> ascending, descending;
+    auto ascIter = container.ascending();
+    for (auto it = ascIter.begin(); it != ascIter.end(); ++it) {
+        ascending.push_back(*it);
+    }
+    auto descIter = container.descending();
+    for (auto it = descIter.begin(); it != descIter.end(); ++it) {
+        descending.push_back(*it);
+    }
+    
+    SUBCASE("Full lazy traversals match the eager orders") {
+        MyContainer<int> fresh = container;
+        fresh.add(50);
+        ascending.insert(std::upper_bound(ascending.begin(), ascending.end(), 50), 50);
+        descending.insert(std::upper_bound(descending.begin(), descending.end(), 50, std::greater<int>()), 50);
+        
+        std::vector<int> actual;
+        auto lazyAsc = fresh.lazyAscending();
+        for (auto it = lazyAsc.begin(); it != lazyAsc.end(); ++it) {
+            actual.push_back(*it);
+        }
+        CHECK(actual == ascending);
+        
+        actual.clear();
+        auto lazyDesc = fresh.lazyDescending();
+        for (auto it = lazyDesc.begin(); it != lazyDesc.end(); ++it) {
+            actual.push_back(*it);
+        }
+        CHECK(actual == descending);
+        
+        // Lazy traversals never build the shared index
+        CHECK(fresh.cacheStats().misses == 1);
+    }
+    
+    SUBCASE("Reading only a prefix") {
+        container.add(-1);
+        auto lazyAsc = container.lazyAscending();
+        auto it = lazyAsc.begin();
+        CHECK(*it == -1);
+        CHECK(*(++it) == ascending[0]);
+        
+        auto lazyDesc = container.lazyDescending();
+        CHECK(*lazyDesc.begin() == descending[0]);
+    }
+    
+    SUBCASE("Copies of one view read on several threads") {
+        auto lazyAsc = container.lazyAscending();
+        std::vector<std::vector<int> > seen(4);
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < seen.size(); ++t) {
+            threads.emplace_back([lazyAsc, &seen, t]() {
+                for (auto it = lazyAsc.begin(); it != lazyAsc.end(); ++it) {
+                    seen[t].push_back(*it);
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        for (const std::vector<int>& values : seen) {
+            CHECK(values == ascending);
+        }
+    }
+    
+    SUBCASE("A current sorted index is reused") {
+        std::vector<int> actual;
+        auto lazyDesc = container.lazyDescending();
+        for (auto it = lazyDesc.begin(); it != lazyDesc.end(); ++it) {
+            actual.push_back(*it);
+        }
+        CHECK(actual == descending);
+    }
+    
+    SUBCASE("Empty container") {
+        MyContainer<int> empty;
+        auto lazyAsc = empty.lazyAscending();
+        CHECK(lazyAsc.begin() == lazyAsc.end());
+        CHECK_THROWS_AS(*lazyAsc.begin(), std::out_of_range);
+    }
+}
+
+TEST_CASE("Non-Throwing Removal") {
+    MyContainer<int> container;
+    container.add(5);
+    container.add(3);
+    container.add(5);
+    container.add(1);
+    container.add(8);
+    
+    SUBCASE("tryRemove reports the number of removed elements") {
+        CHECK(container.tryRemove(5) == 2);
+        CHECK(container.size() == 3);
+        CHECK_NOTHROW(container.tryRemove(42));
+        CHECK(container.tryRemove(42) == 0);
+        CHECK(container.size() == 3);
+    }
+    
+    SUBCASE("removeAny removes every listed value in one call") {
+        std::vector<int> values = {8, 5, 100};
+        CHECK(container.removeAny(values) == 3);
+        
+        std::vector<int> actual;
+        auto orderIter = container.order();
+        for (auto it = orderIter.begin(); it != orderIter.end(); ++it) {
+            actual.push_back(*it);
+        }
+        CHECK(actual == std::vector<int>({3, 1}));
+        
+        CHECK(container.removeAny({1, 3}) == 2);
+        CHECK(container.empty());
+        CHECK(container.removeAny({1}) == 0);
+    }
+    
+    SUBCASE("Only successful removals invalidate the sorted index") {
+        container.ascending();
+        container.tryRemove(42);
+        container.removeAny({7, 9});
+        container.ascending();
+        CHECK(container.cacheStats().hits == 1);
+        
+        container.tryRemove(3);
+        container.ascending();
+        CHECK(container.cacheStats().misses == 2);
+    }
+}
+
+TEST_CASE("Membership Index") {
+    MyContainer<int> container;
+    container.add(4);
+    container.add(9);
+    container.add(4);
+    container.setMembershipIndex(true);
+    
+    SUBCASE("Existing contents are indexed") {
+        CHECK(container.hasMembershipIndex());
+        CHECK(container.count(4) == 2);
+        CHECK(container.contains(9));
+        CHECK_FALSE(container.contains(5));
+    }
+    
+    SUBCASE("Removal keeps the order of the other elements") {
+        container.add(7);
+        container.add(4);
+        CHECK(container.tryRemove(4) == 3);
+        CHECK(container.tryRemove(4) == 0);
+        CHECK_THROWS_AS(container.remove(4), std::invalid_argument);
+        
+        std::vector<int> actual;
+        auto orderIter = container.order();
+        for (auto it = orderIter.begin(); it != orderIter.end(); ++it) {
+            actual.push_back(*it);
+        }
+        CHECK(actual == std::vector<int>({9, 7}));
+        CHECK(container.count(7) == 1);
+    }
+    
+    SUBCASE("Copies own their index") {
+        MyContainer<int> copy = container;
+        copy.remove(9);
+        CHECK(container.contains(9));
+        CHECK_FALSE(copy.contains(9));
+    }
+    
+    SUBCASE("Index agrees with a scan under heavy churn") {
+        MyContainer<int> plain;
+        plain.add(4);
+        plain.add(9);
+        plain.add(4);
+        for (int i = 0; i < 2000; ++i) {
+            int value = (i * 7919) % 613;
+            container.add(value);
+            plain.add(value);
+            if (i % 3 == 0) {
+                int victim = (i * 31) % 613;
+                CHECK(container.tryRemove(victim) == plain.tryRemove(victim));
+            }
+        }
+        container.removeAny({1, 2, 3, 4});
+        plain.removeAny({1, 2, 3, 4});
+        
+        for (int value = 0; value < 613; ++value) {
+            CHECK(container.count(value) == plain.count(value));
+        }
+        CHECK(container.size() == plain.size());
+    }
+    
+    SUBCASE("Disabling falls back to scanning") {
+        container.setMembershipIndex(false);
+        CHECK_FALSE(container.hasMembershipIndex());
+        CHECK(container.count(4) == 2);
+    }
+}
+
+// Positions of the ascending order, to compare permutations and not just values
+template<typename T>
+std::vector<long> ascendingPositions(const MyContainer<T>& container) {
+    std::vector<long> positions;
+    const T* first = &*container.order().begin();
+    auto ascIter = container.ascending();
+    for (auto it = ascIter.begin(); it != ascIter.end(); ++it) {
+        positions.push_back(static_cast<long>(&*it - first));
+    }
+    return positions;
+}
+
+TEST_CASE("Radix Sort Matches Comparison Sort") {
+    SUBCASE("Signed integers with duplicates") {
+        MyContainer<int> comparison, radix;
+        comparison.setSortAlgorithm(SortAlgorithm::Comparison);
+        radix.setSortAlgorithm(SortAlgorithm::Radix);
+        for (int i = 0; i < 1000; ++i) {
+            int value = ((i * 7919) % 401 - 200) * 1000003;
+            comparison.add(value);
+            radix.add(value);
+        }
+        comparison.add(std::numeric_limits<int>::min());
+        radix.add(std::numeric_limits<int>::min());
+        comparison.add(std::numeric_limits<int>::max());
+        radix.add(std::numeric_limits<int>::max());
+        
+        CHECK(ascendingPositions(radix) == ascendingPositions(comparison));
+    }
+    
+    SUBCASE("Doubles including negative zero") {
+        MyContainer<double> comparison, radix;
+        comparison.setSortAlgorithm(SortAlgorithm::Comparison);
+        radix.setSortAlgorithm(SortAlgorithm::Radix);
+        const double values[] = {2.5, -0.0, -1e300, 0.0, 3.25, -2.5, 1e-300, -0.0, 2.5, -1e-300};
+        for (double value : values) {
+            comparison.add(value);
+            radix.add(value);
+        }
+        
+        CHECK(ascendingPositions(radix) == ascendingPositions(comparison));
+    }
+    
+    SUBCASE("Narrow and wide integer types") {
+        MyContainer<unsigned char> bytesComparison, bytesRadix;
+        MyContainer<long long> wideComparison, wideRadix;
+        bytesComparison.setSortAlgorithm(SortAlgorithm::Comparison);
+        bytesRadix.setSortAlgorithm(SortAlgorithm::Radix);
+        wideComparison.setSortAlgorithm(SortAlgorithm::Comparison);
+        wideRadix.setSortAlgorithm(SortAlgorithm::Radix);
+        for (int i = 0; i < 600; ++i) {
+            unsigned char byte = static_cast<unsigned char>((i * 37) % 256);
+            long long wide = static_cast<long long>((i * 37) % 256 - 128) * (1LL << 40);
+            bytesComparison.add(byte);
+            bytesRadix.add(byte);
+            wideComparison.add(wide);
+            wideRadix.add(wide);
+        }
+        
+        CHECK(ascendingPositions(bytesRadix) == ascendingPositions(bytesComparison));
+        CHECK(ascendingPositions(wideRadix) == ascendingPositions(wideComparison));
+    }
+    
+    SUBCASE("Strings fall back to comparison sort") {
+        MyContainer<std::string> container;
+        container.setSortAlgorithm(SortAlgorithm::Radix);
+        container.add("b");
+        container.add("a");
+        CHECK(*container.ascending().begin() == "a");
+    }
+    
+    SUBCASE("Auto bounds the radix scratch space") {
+        typedef std::uint32_t Index;
+        const size_t limit = detail::radixSortMemoryLimit;
+        CHECK_FALSE(detail::radixSortPays<int, Index>(detail::radixSortThreshold - 1));
+        CHECK(detail::radixSortPays<int, Index>(detail::radixSortThreshold));
+        // 8-byte entries for int, 16-byte ones for double
+        CHECK(detail::radixSortPays<int, Index>(limit / 16));
+        CHECK_FALSE(detail::radixSortPays<int, Index>(limit / 16 + 1));
+        CHECK(detail::radixSortPays<double, Index>(limit / 32));
+        CHECK_FALSE(detail::radixSortPays<double, Index>(limit / 32 + 1));
+        CHECK_FALSE(detail::radixSortPays<std::string, Index>(5000));
+    }
+}
+
+TEST_CASE("Parallel Sort Matches Serial Sort") {
+    // Large enough to be split across threads, with many duplicates
+    auto makeContainer = [](SortAlgorithm algorithm, unsigned threads) {
+        MyContainer<int> container;
+        container.setSortAlgorithm(algorithm);
+        container.setSortThreads(threads);
+        for (int i = 0; i < 200000; ++i) {
+            container.add((i * 7919) % 5003);
+        }
+        return container;
+    };
+    std::vector<long> expected = ascendingPositions(makeContainer(SortAlgorithm::Comparison, 1));
+    
+    const unsigned threadCounts[] = {2, 3, 4, 0};
+    for (unsigned threads : threadCounts) {
+        CAPTURE(threads);
+        CHECK(ascendingPositions(makeContainer(SortAlgorithm::Comparison, threads)) == expected);
+        CHECK(ascendingPositions(makeContainer(SortAlgorithm::Radix, threads)) == expected);
+    }
+}
+
+template<typename T>
+void checkVectorKernels(const std::vector<T>& values, const std::vector<T>& probes) {
+    const simd::Level levels[] = {simd::Level::Scalar, simd::Level::Sse41, simd::Level::Avx2};
+    for (simd::Level level : levels) {
+        simd::setLevel(level);
+        CAPTURE(static_cast<int>(simd::activeLevel()));
+        for (const T& probe : probes) {
+            MyContainer<T> container;
+            for (const T& value : values) {
+                container.add(value);
+            }
+            std::vector<T> expected;
+            for (const T& value : values) {
+                if (!(value == probe)) expected.push_back(value);
+            }
+            size_t instances = values.size() - expected.size();
+            
+            CHECK(container.count(probe) == instances);
+            CHECK(container.contains(probe) == (instances != 0));
+            CHECK(container.tryRemove(probe) == instances);
+            
+            std::vector<T> actual;
+            auto orderIter = container.order();
+            for (auto it = orderIter.begin(); it != orderIter.end(); ++it) {
+                actual.push_back(*it);
+            }
+            CHECK(actual.size() == expected.size());
+            CHECK(std::equal(actual.begin(), actual.end(), expected.begin(), [](const T& a, const T& b) {
+                return a == b || (a != a && b != b);
+            }));
+        }
+    }
+    simd::setLevel(simd::detectedLevel());
+}
+
+TEST_CASE("Vectorized Search And Removal") {
+    SUBCASE("32-bit and 64-bit integers") {
+        std::vector<int> ints;
+        std::vector<long long> longs;
+        for (int i = 0; i < 103; ++i) {
+            ints.push_back((i * 13) % 7 - 3);
+            longs.push_back(static_cast<long long>((i * 13) % 7) << 33);
+        }
+        checkVectorKernels(ints, std::vector<int>({-3, 0, 3, 42}));
+        checkVectorKernels(longs, std::vector<long long>({0, 1ll << 33, 6ll << 33, 1}));
+    }
+    
+    SUBCASE("Floating point equality semantics") {
+        const float nan = std::numeric_limits<float>::quiet_NaN();
+        std::vector<float> floats = {1.5f, -0.0f, nan, 0.0f, 2.5f, 1.5f, nan, -1.5f, 0.0f};
+        std::vector<double> doubles;
+        for (int i = 0; i < 37; ++i) {
+            doubles.push_back(i % 3 == 0 ? -0.0 : i * 0.5);
+        }
+        checkVectorKernels(floats, std::vector<float>({1.5f, 0.0f, -0.0f, nan, 9.0f}));
+        checkVectorKernels(doubles, std::vector<double>({0.0, 2.0, 18.0, -1.0}));
+    }
+}
+
+// Counts copies so tests can tell whether an insertion moved or copied
+struct CopyCounter {
+    static int copies;
+    int value;
+    
+    CopyCounter(int v) : value(v) {}
+    CopyCounter(const CopyCounter& other) : value(other.value) { copies++; }
+    CopyCounter(CopyCounter&& other) noexcept : value(other.value) {}
+    CopyCounter& operator=(const CopyCounter& other) { value = other.value; copies++; return *this; }
+    CopyCounter& operator=(CopyCounter&& other) noexcept { value = other.value; return *this; }
+    bool operator<(const CopyCounter& other) const { return value < other.value; }
+    bool operator==(const CopyCounter& other) const { return value == other.value; }
+};
+int CopyCounter::copies = 0;
+
+TEST_CASE("Move-Aware Insertion") {
+    SUBCASE("Temporaries and emplace do not copy") {
+        MyContainer<CopyCounter> container;
+        CopyCounter::copies = 0;
+        container.add(CopyCounter(3));
+        container.emplace(1);
+        CopyCounter named(2);
+        container.add(std::move(named));
+        CHECK(CopyCounter::copies == 0);
+        CHECK(container.size() == 3);
+        CHECK((*container.ascending().begin()).value == 1);
+    }
+    
+    SUBCASE("Ranges are appended and can be moved in") {
+        MyContainer<std::string> container;
+        container.add({"pear", "apple"});
+        std::vector<std::string> more = {"fig", "kiwi"};
+        container.addRange(std::make_move_iterator(more.begin()), std::make_move_iterator(more.end()));
+        CHECK(container.size() == 4);
+        CHECK(*container.ascending().begin() == "apple");
+        
+        std::vector<std::string> order;
+        auto orderIter = container.order();
+        for (auto it = orderIter.begin(); it != orderIter.end(); ++it) {
+            order.push_back(*it);
+        }
+        CHECK(order == std::vector<std::string>({"pear", "apple", "fig", "kiwi"}));
+    }
+    
+    SUBCASE("Bulk insertion keeps the membership index and cache in sync") {
+        MyContainer<int> container;
+        container.setMembershipIndex(true);
+        container.add(5);
+        CHECK(*container.ascending().begin() == 5);
+        std::vector<int> values = {7, 1, 7};
+        container.addRange(values.begin(), values.end());
+        CHECK(container.count(7) == 2);
+        CHECK(container.contains(1));
+        CHECK(*container.ascending().begin() == 1);
+        container.addRange(values.begin(), values.begin());
+        CHECK(container.size() == 4);
+    }
+    
+    SUBCASE("Moving a container leaves the source empty and usable") {
+        MyContainer<int> source;
+        source.setMembershipIndex(true);
+        source.add({4, 2, 9});
+        CHECK(*source.ascending().begin() == 2);
+        const int* storage = &*source.order().begin();
+        
+        MyContainer<int> moved(std::move(source));
+        CHECK(moved.size() == 3);
+        CHECK(&*moved.order().begin() == storage);
+        CHECK(moved.hasMembershipIndex());
+        CHECK(moved.count(9) == 1);
+        CHECK(*moved.ascending().begin() == 2);
+        
+        CHECK(source.empty());
+        CHECK_FALSE(source.hasMembershipIndex());
+        CHECK(source.ascending().begin() == source.ascending().end());
+        source.add(8);
+        CHECK(*source.ascending().begin() == 8);
+        
+        MyContainer<int> assigned;
+        assigned.add(1);
+        assigned = std::move(moved);
+        CHECK(assigned.size() == 3);
+        CHECK(*assigned.descending().begin() == 9);
+        CHECK(moved.empty());
+    }
+}
+
+TEST_CASE("Arena Allocator") {
+    typedef MyContainer<int, ArenaAllocator<int> > ArenaContainer;
+    MonotonicArena arena(256);
+    
+    SUBCASE("Storage and sorted orders come from the arena") {
+        ArenaContainer container{ArenaAllocator<int>(arena)};
+        MyContainer<int> reference;
+        for (int i = 0; i < 2000; ++i) {
+            int value = (i * 7919) % 1009 - 500;
+            container.add(value);
+            reference.add(value);
+        }
+        size_t storageBytes = arena.bytesUsed();
+        CHECK(storageBytes >= 2000 * sizeof(int));
+        CHECK(container.getAllocator() == ArenaAllocator<int>(arena));
+        
+        std::vector<int> ascending, expected;
+        auto ascIter = container.ascending();
+        for (auto it = ascIter.begin(); it != ascIter.end(); ++it) ascending.push_back(*it);
+        auto refIter = reference.ascending();
+        for (auto it = refIter.begin(); it != refIter.end(); ++it) expected.push_back(*it);
+        CHECK(ascending == expected);
+        CHECK(arena.bytesUsed() > storageBytes + 2000 * sizeof(ArenaContainer::Index));
+        
+        container.setSortAlgorithm(SortAlgorithm::Radix);
+        container.add(-1000);
+        CHECK(*container.ascending().begin() == -1000);
+        CHECK(*container.lazyDescending().begin() == 508);
+    }
+    
+    SUBCASE("Reset reuses the blocks") {
+        for (int request = 0; request < 3; ++request) {
+            {
+                ArenaContainer container{ArenaAllocator<int>(arena)};
+                container.add({3, 1, 2});
+                CHECK(*container.sideCross().begin() == 1);
+                CHECK(*container.lazyAscending().begin() == 1);
+            }
+            size_t blocks = arena.blockCount();
+            arena.reset();
+            CHECK(arena.bytesUsed() == 0);
+            CHECK(arena.blockCount() == blocks);
+        }
+    }
+    
+    SUBCASE("Copies and moves keep the arena") {
+        ArenaContainer container{ArenaAllocator<int>(arena)};
+        container.add({5, 4});
+        ArenaContainer copy = container;
+        CHECK(copy.getAllocator() == container.getAllocator());
+        ArenaContainer moved(std::move(copy));
+        CHECK(moved.size() == 2);
+        CHECK(copy.empty());
+        copy = std::move(moved);
+        CHECK(*copy.ascending().begin() == 4);
+    }
+    
+    SUBCASE("Misaligned requests are aligned") {
+        MonotonicArena small(16);
+        void* a = small.allocate(3, 1);
+        void* b = small.allocate(8, 8);
+        void* c = small.allocate(100, 16);
+        CHECK(a != nullptr);
+        CHECK(reinterpret_cast<std::uintptr_t>(b) % 8 == 0);
+        CHECK(reinterpret_cast<std::uintptr_t>(c) % 16 == 0);
+        CHECK(small.bytesUsed() == 111);
+    }
+}
+
+// The six orders of a container, concatenated with a separator between them
+template<typename Container>
+std::vector<int> sixOrders(const Container& container) {
+    std::vector<int> result;
+    auto ascending = container.ascending();
+    for (auto it = ascending.begin(); it != ascending.end(); ++it) result.push_back(*it);
+    result.push_back(-1);
+    auto descending = container.descending();
+    for (auto it = descending.begin(); it != descending.end(); ++it) result.push_back(*it);
+    result.push_back(-1);
+    auto sideCross = container.sideCross();
+    for (auto it = sideCross.begin(); it != sideCross.end(); ++it) result.push_back(*it);
+    result.push_back(-1);
+    auto reverse = container.reverse();
+    for (auto it = reverse.begin(); it != reverse.end(); ++it) result.push_back(*it);
+    result.push_back(-1);
+    auto order = container.order();
+    for (auto it = order.begin(); it != order.end(); ++it) result.push_back(*it);
+    result.push_back(-1);
+    auto middleOut = container.middleOut();
+    for (auto it = middleOut.begin(); it != middleOut.end(); ++it) result.push_back(*it);
+    return result;
+}
+
+TEST_CASE("Small Container") {
+    SUBCASE("Orders match MyContainer inline and after spilling") {
+        for (int size = 0; size <= 11; ++size) {
+            CAPTURE(size);
+            SmallMyContainer<int, 8> small;
+            MyContainer<int> reference;
+            for (int i = 0; i < size; ++i) {
+                small.add((i * 5) % 7);
+                reference.add((i * 5) % 7);
+            }
+            CHECK(small.size() == reference.size());
+            CHECK(small.isSpilled() == (size > 8));
+            CHECK(sixOrders(small) == sixOrders(reference));
+        }
+    }
+    
+    SUBCASE("Removal, search and output") {
+        SmallMyContainer<int, 4> small;
+        small.add(3);
+        small.add(1);
+        small.add(3);
+        CHECK(small.count(3) == 2);
+        CHECK(small.contains(1));
+        CHECK(small.tryRemove(3) == 2);
+        CHECK_THROWS_AS(small.remove(3), std::invalid_argument);
+        for (int i = 0; i < 5; ++i) small.add(i);
+        CHECK(small.isSpilled());
+        small.remove(1);
+        auto before = sixOrders(small);
+        CHECK(small.tryRemove(9) == 0);
+        CHECK(sixOrders(small) == before);
+        std::ostringstream os;
+        os << small;
+        CHECK(os.str() == "[0, 2, 3, 4]");
+        small.clear();
+        CHECK(small.empty());
+        CHECK_FALSE(small.isSpilled());
+    }
+    
+    SUBCASE("Copies and moves of inline and spilled containers") {
+        SmallMyContainer<std::string, 2> inlineStrings, spilledStrings;
+        inlineStrings.add("b");
+        inlineStrings.emplace(3, 'a');
+        for (int i = 0; i < 3; ++i) spilledStrings.add(std::string(1, static_cast<char>('x' + i)));
+        
+        SmallMyContainer<std::string, 2> copy(inlineStrings);
+        CHECK(*copy.ascending().begin() == "aaa");
+        copy = spilledStrings;
+        CHECK(copy.isSpilled());
+        CHECK(*copy.descending().begin() == "z");
+        
+        SmallMyContainer<std::string, 2> moved(std::move(copy));
+        CHECK(moved.size() == 3);
+        CHECK(copy.empty());
+        moved = std::move(inlineStrings);
+        CHECK_FALSE(moved.isSpilled());
+        CHECK(*moved.order().begin() == "b");
+        CHECK(inlineStrings.empty());
+        
+        // The element added on spill may alias an inline one
+        SmallMyContainer<std::string, 2> aliasing;
+        aliasing.add("p");
+        aliasing.add("q");
+        aliasing.add(*aliasing.order().begin());
+        CHECK(*aliasing.reverse().begin() == "p");
+    }
+}
+
+TEST_CASE("Concurrent Container") {
+    SUBCASE("Concurrent adds keep every element and each thread's order") {
+        ConcurrentMyContainer<int> container(3);
+        const int threadCount = 4;
+        const int perThread = 5000;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < threadCount; ++t) {
+            threads.emplace_back([&container, t]() {
+                for (int i = 0; i < perThread; ++i) {
+                    container.add(t * perThread + i);
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        CHECK(container.size() == static_cast<size_t>(threadCount * perThread));
+        
+        std::vector<int> lastSeen(threadCount, -1);
+        bool ordered = true;
+        auto orderIter = container.order();
+        for (auto it = orderIter.begin(); it != orderIter.end(); ++it) {
+            int thread = *it / perThread;
+            ordered = ordered && *it > lastSeen[thread];
+            lastSeen[thread] = *it;
+        }
+        CHECK(ordered);
+        
+        int expected = 0;
+        bool ascending = true;
+        auto ascIter = container.ascending();
+        for (auto it = ascIter.begin(); it != ascIter.end(); ++it) {
+            ascending = ascending && *it == expected++;
+        }
+        CHECK(ascending);
+        CHECK(*container.descending().begin() == threadCount * perThread - 1);
+    }
+    
+    SUBCASE("Views keep their snapshot while the container changes") {
+        ConcurrentMyContainer<int> container(2);
+        container.add(3);
+        container.add(1);
+        container.add(3);
+        auto before = container.sideCross();
+        CHECK(container.tryRemove(3) == 2);
+        CHECK_THROWS_AS(container.remove(3), std::invalid_argument);
+        container.add(7);
+        
+        std::vector<int> seen;
+        for (auto it = before.begin(); it != before.end(); ++it) seen.push_back(*it);
+        CHECK(seen == std::vector<int>({1, 3, 3}));
+        CHECK(container.count(7) == 1);
+        CHECK(container.contains(1));
+        std::ostringstream os;
+        os << container;
+        CHECK(os.str() == "[1, 7]");
+    }
+    
+    SUBCASE("Removal concurrent with adds is consistent") {
+        ConcurrentMyContainer<int> container;
+        std::atomic<bool> done(false);
+        std::thread writer([&container, &done]() {
+            for (int i = 0; i < 20000; ++i) {
+                container.add(i % 10);
+            }
+            done = true;
+        });
+        while (!done) {
+            container.tryRemove(0);
+            MyContainer<int> snapshot = container.snapshot();
+            CHECK(snapshot.size() <= 20000);
+        }
+        writer.join();
+        container.tryRemove(0);
+        CHECK(container.size() == 18000);
+        CHECK_FALSE(container.contains(0));
+    }
+}
+
+TEST_CASE("Snapshots") {
+    MyContainer<int> container;
+    container.setMembershipIndex(true);
+    container.add({5, 3, 8, 3});
+    CHECK(*container.ascending().begin() == 3);
+    
+    SUBCASE("A snapshot shares storage and the sorted index") {
+        MyContainer<int> snapshot = container.snapshot();
+        CHECK(&*snapshot.order().begin() == &*container.order().begin());
+        size_t misses = snapshot.cacheStats().misses;
+        CHECK(*snapshot.descending().begin() == 8);
+        CHECK(snapshot.cacheStats().misses == misses);
+        
+        // Misses do not copy the shared storage
+        CHECK(container.tryRemove(42) == 0);
+        CHECK(container.removeAny({41, 42}) == 0);
+        CHECK(&*snapshot.order().begin() == &*container.order().begin());
+    }
+    
+    SUBCASE("Changes after a snapshot are invisible to it") {
+        MyContainer<int> snapshot = container.snapshot();
+        auto view = snapshot.ascending();
+        container.add(1);
+        container.remove(3);
+        container.removeAny({8});
+        
+        std::vector<int> seen;
+        for (auto it = view.begin(); it != view.end(); ++it) seen.push_back(*it);
+        CHECK(seen == std::vector<int>({3, 3, 5, 8}));
+        CHECK(snapshot.count(3) == 2);
+        CHECK(snapshot.contains(8));
+        CHECK(container.count(3) == 0);
+        CHECK(container.size() == 2);
+        CHECK(*container.ascending().begin() == 1);
+        
+        // The snapshot is a container in its own right
+        snapshot.add(0);
+        CHECK(*snapshot.ascending().begin() == 0);
+        CHECK(container.size() == 2);
+    }
+    
+    SUBCASE("Readers traverse while the writer keeps changing") {
+        for (int i = 0; i < 1000; ++i) container.add(i);
+        MyContainer<int> snapshot = container.snapshot();
+        long long sum = 0;
+        std::thread reader([&snapshot, &sum]() {
+            for (int pass = 0; pass < 20; ++pass) {
+                auto view = snapshot.sideCross();
+                for (auto it = view.begin(); it != view.end(); ++it) sum += *it;
+            }
+        });
+        for (int i = 0; i < 2000; ++i) {
+            container.add(i);
+            if (i % 100 == 0) container.tryRemove(i / 2);
+        }
+        reader.join();
+        CHECK(sum == 20LL * (499500 + 5 + 3 + 8 + 3));
+    }
+}
+
+TEST_CASE("Copy-On-Write Copies") {
+    MyContainer<std::string> original;
+    original.add({"pear", "fig", "apple"});
+    CHECK(*original.ascending().begin() == "apple");
+    
+    SUBCASE("Copies are deep by default") {
+        MyContainer<std::string> copy(original);
+        CHECK_FALSE(copy.isCopyOnWrite());
+        CHECK(&*copy.order().begin() != &*original.order().begin());
+    }
+    
+    SUBCASE("Copies share storage and the sorted index until a change") {
+        original.setCopyOnWrite(true);
+        MyContainer<std::string> copy(original);
+        MyContainer<std::string> assigned;
+        assigned = copy;
+        CHECK(copy.isCopyOnWrite());
+        CHECK(&*copy.order().begin() == &*original.order().begin());
+        CHECK(&*assigned.order().begin() == &*original.order().begin());
+        size_t misses = copy.cacheStats().misses;
+        CHECK(*copy.sideCross().begin() == "apple");
+        CHECK(copy.cacheStats().misses == misses);
+        
+        copy.add("kiwi");
+        assigned.remove("fig");
+        CHECK(original.size() == 3);
+        CHECK(copy.size() == 4);
+        CHECK(assigned.size() == 2);
+        CHECK(&*copy.order().begin() != &*original.order().begin());
+        CHECK(*original.descending().begin() == "pear");
+        CHECK(*assigned.ascending().begin() == "apple");
+        CHECK(original.contains("fig"));
+    }
+    
+    SUBCASE("The writer keeps its buffer once the copies are gone") {
+        original.setCopyOnWrite(true);
+        const std::string* before = &*original.order().begin();
+        {
+            MyContainer<std::string> copy(original);
+        }
+        original.remove("fig");
+        CHECK(&*original.order().begin() == before);
+    }
+}
+
+// Path of a scratch file that does not exist yet and is deleted on scope exit
+struct TemporaryPath {
+    std::string path;
+    
+    explicit TemporaryPath(const std::string& name)
+        : path("/tmp/mycontainer_" + std::to_string(::getpid()) + "_" + name) {
+        std::remove(path.c_str());
+    }
+    ~TemporaryPath() {
+        std::remove(path.c_str());
+    }
+};
+
+TEST_CASE("Memory-Mapped Container") {
+    TemporaryPath file("mapped.bin");
+    
+    SUBCASE("Orders match MyContainer across growth and removal") {
+        MappedMyContainer<long long> mapped(file.path);
+        MyContainer<long long> reference;
+        for (long long i = 0; i < 5000; ++i) {
+            mapped.add((i * 7919) % 101);
+            reference.add((i * 7919) % 101);
+        }
+        CHECK(mapped.capacity() >= 5000);
+        CHECK(mapped.tryRemove(7) == reference.tryRemove(7));
+        mapped.remove(8);
+        reference.remove(8);
+        CHECK_THROWS_AS(mapped.remove(8), std::invalid_argument);
+        CHECK(mapped.size() == reference.size());
+        CHECK(mapped.count(9) == reference.count(9));
+        CHECK_FALSE(mapped.contains(7));
+        
+        std::vector<long long> actual, expected;
+        auto mappedReverse = mapped.reverse();
+        for (auto it = mappedReverse.begin(); it != mappedReverse.end(); ++it) actual.push_back(*it);
+        auto referenceReverse = reference.reverse();
+        for (auto it = referenceReverse.begin(); it != referenceReverse.end(); ++it) expected.push_back(*it);
+        CHECK(actual == expected);
+        
+        actual.clear();
+        expected.clear();
+        auto mappedMiddle = mapped.middleOut();
+        for (auto it = mappedMiddle.begin(); it != mappedMiddle.end(); ++it) actual.push_back(*it);
+        auto referenceMiddle = reference.middleOut();
+        for (auto it = referenceMiddle.begin(); it != referenceMiddle.end(); ++it) expected.push_back(*it);
+        CHECK(actual == expected);
+    }
+    
+    SUBCASE("Reopening sees every completed add") {
+        {
+            MappedMyContainer<int> mapped(file.path);
+            mapped.add(4);
+            mapped.add(2);
+            mapped.add(4);
+            mapped.remove(2);
+        }
+        MappedMyContainer<int> reopened(file.path);
+        CHECK(reopened.size() == 2);
+        reopened.shrinkToFit();
+        CHECK(reopened.capacity() == 2);
+        // The argument lives in the mapping that growing moves
+        reopened.add(*reopened.order().begin());
+        CHECK(reopened.capacity() > 2);
+        reopened.add(9);
+        std::ostringstream os;
+        os << reopened;
+        CHECK(os.str() == "[4, 4, 4, 9]");
+        
+        MappedMyContainer<int> moved(std::move(reopened));
+        CHECK(moved.size() == 4);
+        moved.flush();
+    }
+    
+    SUBCASE("Foreign files are rejected") {
+        {
+            MappedMyContainer<int> mapped(file.path);
+            mapped.add(1);
+        }
+        CHECK_THROWS_AS(MappedMyContainer<long long>(file.path), std::runtime_error);
+        TemporaryPath garbage("garbage.bin");
+        FILE* out = std::fopen(garbage.path.c_str(), "wb");
+        std::fputs("definitely not a container file, but longer than a header..........", out);
+        std::fclose(out);
+        CHECK_THROWS_AS(MappedMyContainer<int>(garbage.path), std::runtime_error);
+        CHECK_THROWS_AS(MappedMyContainer<int>("/nonexistent/dir/file.bin"), std::system_error);
+    }
+}
+
+// Orders by key only, so the tags show where equal elements end up
+struct Keyed {
+    int key;
+    int tag;
+    
+    bool operator<(const Keyed& other) const {
+        return key < other.key;
+    }
+};
+
+template<typename View>
+std::vector<int> tagsOf(const View& view) {
+    std::vector<int> tags;
+    for (auto it = view.begin(); it != view.end(); ++it) tags.push_back((*it).tag);
+    return tags;
+}
+
+TEST_CASE("External Sort") {
+    TemporaryPath file("external.bin");
+    MappedMyContainer<Keyed> mapped(file.path);
+    MyContainer<Keyed> reference;
+    for (int i = 0; i < 20000; ++i) {
+        Keyed element{(i * 7919) % 257, i};
+        mapped.add(element);
+        reference.add(element);
+    }
+    CHECK(mapped.getSortMemoryBudget() >= 20000 * sizeof(Keyed));
+    std::vector<int> ascendingTags = tagsOf(reference.ascending());
+    std::vector<int> descendingTags = tagsOf(reference.descending());
+    std::vector<int> sideCrossTags = tagsOf(reference.sideCross());
+    
+    SUBCASE("In memory") {
+        CHECK(tagsOf(mapped.ascending()) == ascendingTags);
+        CHECK(tagsOf(mapped.descending()) == descendingTags);
+        CHECK(tagsOf(mapped.sideCross()) == sideCrossTags);
+    }
+    
+    SUBCASE("Across sorted runs, ties stay stable") {
+        // 13 runs of 1600 elements plus a short one, merged in small blocks
+        mapped.setSortMemoryBudget(1600 * sizeof(Keyed));
+        CHECK(tagsOf(mapped.ascending()) == ascendingTags);
+        CHECK(tagsOf(mapped.descending()) == descendingTags);
+        CHECK(tagsOf(mapped.sideCross()) == sideCrossTags);
+        
+        mapped.setSortMemoryBudget(1);
+        CHECK(mapped.getSortMemoryBudget() == sizeof(Keyed));
+        auto ascending = mapped.ascending();
+        CHECK((*ascending).tag == ascendingTags[0]);
+        auto it = ascending.begin();
+        ++it;
+        CHECK((*it).tag == ascendingTags[1]);
+        // A new begin() restarts the merge
+        CHECK((*ascending.begin()).tag == ascendingTags[0]);
+        auto end = ascending.end();
+        CHECK_THROWS_AS(*end, std::out_of_range);
+    }
+    
+    SUBCASE("Sorted views are snapshots") {
+        mapped.setSortMemoryBudget(4096);
+        auto descending = mapped.descending();
+        mapped.add(Keyed{1000, -1});
+        CHECK(tagsOf(descending) == descendingTags);
+        CHECK(tagsOf(mapped.descending()).front() == -1);
+        // An odd count ends the sideCross walk on the ascending merge
+        reference.add(Keyed{1000, -1});
+        CHECK(tagsOf(mapped.sideCross()) == tagsOf(reference.sideCross()));
+    }
+}
+
+TEST_CASE("Binary Save And Load") {
+    TemporaryPath file("saved.bin");
+    
+    SUBCASE("Numbers round-trip") {
+        MyContainer<double> container;
+        for (int i = 0; i < 3000; ++i) {
+            container.add((i * 37 % 101) / 4.0);
+        }
+        container.save(file.path);
+        MyContainer<double> loaded = MyContainer<double>::load(file.path);
+        CHECK(loaded.size() == container.size());
+        std::ostringstream expected, actual;
+        expected << container;
+        actual << loaded;
+        CHECK(actual.str() == expected.str());
+        CHECK(*loaded.ascending().begin() == 0.0);
+        CHECK(loaded.count(0.25) == container.count(0.25));
+        
+        MyContainer<int> empty;
+        empty.save(file.path);
+        CHECK(MyContainer<int>::load(file.path).empty());
+    }
+    
+    SUBCASE("binary::load appends") {
+        MyContainer<int> numbers;
+        numbers.add({4, 5});
+        numbers.save(file.path);
+        std::vector<int> elements{1, 2, 3};
+        binary::load(file.path, elements);
+        CHECK(elements == std::vector<int>{1, 2, 3, 4, 5});
+        
+        MyContainer<std::string> words;
+        words.add("b");
+        words.save(file.path);
+        std::vector<std::string> strings{"a"};
+        binary::load(file.path, strings);
+        CHECK(strings == std::vector<std::string>{"a", "b"});
+    }
+    
+    SUBCASE("Strings round-trip") {
+        MyContainer<std::string> container;
+        container.add("banana");
+        container.add("");
+        container.add(std::string("with\0nul", 8));
+        container.add(std::string(5000, 'x'));
+        container.save(file.path);
+        MyContainer<std::string> loaded = MyContainer<std::string>::load(file.path);
+        std::vector<std::string> actual;
+        auto order = loaded.order();
+        for (auto it = order.begin(); it != order.end(); ++it) actual.push_back(*it);
+        CHECK(actual == std::vector<std::string>{"banana", "", std::string("with\0nul", 8), std::string(5000, 'x')});
+    }
+    
+    SUBCASE("Other types and damaged files are rejected") {
+        MyContainer<int> container;
+        container.add({1, 2, 3});
+        container.save(file.path);
+        CHECK_THROWS_AS(MyContainer<unsigned>::load(file.path), std::runtime_error);
+        CHECK_THROWS_AS(MyContainer<long long>::load(file.path), std::runtime_error);
+        CHECK_THROWS_AS(MyContainer<float>::load(file.path), std::runtime_error);
+        CHECK_THROWS_AS(MyContainer<std::string>::load(file.path), std::runtime_error);
+        CHECK_THROWS_AS(MyContainer<int>::load(file.path + ".missing"), std::system_error);
+        
+        // Cut off the last element
+        std::string bytes;
+        {
+            std::ifstream in(file.path, std::ios::binary);
+            bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+        {
+            std::ofstream out(file.path, std::ios::binary | std::ios::trunc);
+            out.write(bytes.data(), static_cast<std::streamsize>(bytes.size() - 1));
+        }
+        CHECK_THROWS_AS(MyContainer<int>::load(file.path), std::runtime_error);
+        
+        CHECK_THROWS_AS(container.save("/nonexistent/dir/saved.bin"), std::system_error);
+    }
+}
+
+// What operator<< printed before fast formatting: every element through the stream
+template<typename T>
+std::string streamed(const std::vector<T>& elements, std::ostringstream& os) {
+    os << "[";
+    for (size_t i = 0; i < elements.size(); ++i) {
+        if (i > 0) os << ", ";
+        os << elements[i];
+    }
+    os << "]";
+    return os.str();
+}
+
+template<typename T>
+void checkFormatting(const std::vector<T>& elements) {
+    MyContainer<T> container;
+    container.addRange(elements.begin(), elements.end());
+    std::ostringstream fast, reference;
+    fast << container;
+    CHECK(fast.str() == streamed(elements, reference));
+    
+    // Non-default streams take the per-element path with the same result
+    std::ostringstream hexFast, hexReference;
+    hexFast << std::hex << std::showpos << std::setprecision(3) << container;
+    hexReference << std::hex << std::showpos << std::setprecision(3);
+    CHECK(hexFast.str() == streamed(elements, hexReference));
+}
+
+TEST_CASE("Fast Formatting") {
+    SUBCASE("Output matches per-element streaming") {
+        checkFormatting(std::vector<int>{0, 7, -7, 10, 99, 100, -100, 123456789,
+                                         std::numeric_limits<int>::max(), std::numeric_limits<int>::min()});
+        checkFormatting(std::vector<long long>{std::numeric_limits<long long>::min(), -1, 1000000000000LL});
+        checkFormatting(std::vector<unsigned long long>{0, 9, std::numeric_limits<unsigned long long>::max()});
+        checkFormatting(std::vector<short>{-32768, 32767});
+        checkFormatting(std::vector<char>{'a', ' ', 'z'});
+        checkFormatting(std::vector<bool>{true, false});
+        checkFormatting(std::vector<double>{0.0, -0.0, 1.0, 0.1, 1.0 / 3, 123456789.0, 1e-5, 1e-4, 1e21, -2.5e-300,
+                                            std::numeric_limits<double>::infinity(),
+                                            std::numeric_limits<double>::quiet_NaN(),
+                                            std::numeric_limits<double>::max(), std::numeric_limits<double>::denorm_min()});
+        checkFormatting(std::vector<float>{1.5f, 3.14159265f, 1e30f});
+        checkFormatting(std::vector<std::string>{"", "a", "with, comma", std::string(40000, 'x')});
+        checkFormatting(std::vector<int>{});
+        
+        // Longer than one chunk
+        std::vector<int> many;
+        for (int i = 0; i < 20000; ++i) many.push_back(i * 7919 - 50000000);
+        checkFormatting(many);
+    }
+    
+    SUBCASE("Precision and width are honored") {
+        MyContainer<double> container;
+        container.add({1.0 / 3, 2.0 / 3});
+        std::ostringstream os;
+        os << std::setprecision(12) << container;
+        CHECK(os.str() == "[0.333333333333, 0.666666666667]");
+        std::ostringstream wide;
+        wide << std::setw(3) << container;
+        CHECK(wide.str() == "  [0.333333, 0.666667]");
+    }
+    
+    SUBCASE("Ordered printing") {
+        MyContainer<int> container;
+        container.add({7, 15, 6, 1, 2});
+        std::ostringstream os;
+        container.printAscending(os) << ' ';
+        container.printDescending(os) << ' ';
+        container.printSideCross(os) << ' ';
+        container.printReverse(os) << ' ';
+        container.printOrder(os) << ' ';
+        container.printMiddleOut(os);
+        CHECK(os.str() == "[1, 2, 6, 7, 15] [15, 7, 6, 2, 1] [1, 15, 2, 7, 6] [2, 1, 6, 15, 7] "
+                          "[7, 15, 6, 1, 2] [6, 15, 1, 7, 2]");
+    }
+}
+
+template<typename T>
+std::vector<T> inOrder(const MyContainer<T>& container) {
+    std::vector<T> elements;
+    auto order = container.order();
+    for (auto it = order.begin(); it != order.end(); ++it) elements.push_back(*it);
+    return elements;
+}
+
+TEST_CASE("Text Parsing") {
+    SUBCASE("Printed lists parse back") {
+        MyContainer<int> ints;
+        for (int i = 0; i < 5000; ++i) ints.add(i * 7919 - 20000000);
+        ints.add({std::numeric_limits<int>::min(), std::numeric_limits<int>::max()});
+        std::ostringstream os;
+        os << ints;
+        CHECK(inOrder(MyContainer<int>::parse(os.str())) == inOrder(ints));
+        
+        MyContainer<double> doubles;
+        doubles.add({0.5, -1e-300, 1e21, std::numeric_limits<double>::infinity()});
+        std::ostringstream precise;
+        precise << std::setprecision(17) << doubles;
+        CHECK(inOrder(MyContainer<double>::parse(precise.str())) == inOrder(doubles));
+        
+        // Tokens longer than the stack buffer of the float parser
+        std::ostringstream longDigits;
+        longDigits << std::setprecision(60) << doubles;
+        CHECK(inOrder(MyContainer<double>::parse(longDigits.str())) == inOrder(doubles));
+        
+        CHECK(inOrder(MyContainer<std::string>::parse("[banana, apple pie,x]")) ==
+              std::vector<std::string>{"banana", "apple pie", "x"});
+        CHECK(MyContainer<int>::parse("  [ ]\n").empty());
+        CHECK(MyContainer<int>::parse("").empty());
+    }
+    
+    SUBCASE("Delimited input") {
+        CHECK(inOrder(MyContainer<int>::parse("1,2\n3\r\n\n -4 , 5\n")) == std::vector<int>{1, 2, 3, -4, 5});
+        CHECK(inOrder(MyContainer<long long>::parse("-9223372036854775808\n9223372036854775807")) ==
+              std::vector<long long>{std::numeric_limits<long long>::min(), std::numeric_limits<long long>::max()});
+        CHECK(inOrder(MyContainer<char>::parse("a,b,c")) == std::vector<char>{'a', 'b', 'c'});
+        std::ostringstream bools;
+        bools << MyContainer<bool>::parse("1,0");
+        CHECK(bools.str() == "[1, 0]");
+    }
+    
+    SUBCASE("Delimiter scanning matches at every level") {
+        std::string text;
+        for (int i = 0; i < 300; ++i) text += (i * 7919) % 13 == 0 ? ',' : (i * 31) % 17 == 0 ? '\n' : 'a';
+        for (simd::Level level : {simd::Level::Scalar, simd::Level::Sse41, simd::Level::Avx2}) {
+            simd::setLevel(level);
+            for (size_t start = 0; start < 40; ++start) {
+                const char* data = text.data() + start;
+                size_t length = text.size() - start;
+                size_t first = text.find_first_of(",\n", start);
+                CHECK(simd::findEither(data, length, ',', '\n') == first - start);
+                CHECK(simd::countEither(data, length, ',', '\n') ==
+                      static_cast<size_t>(std::count_if(data, data + length, [](char c) { return c == ',' || c == '\n'; })));
+            }
+            CHECK(simd::findEither(text.data(), text.size(), '#', '$') == text.size());
+            CHECK(inOrder(MyContainer<std::string>::parse("[x, yy, zzz]")) == std::vector<std::string>{"x", "yy", "zzz"});
+        }
+        simd::setLevel(simd::detectedLevel());
+    }
+    
+    SUBCASE("Malformed input is rejected without changes") {
+        CHECK_THROWS_AS(MyContainer<int>::parse("[1, 2"), std::invalid_argument);
+        CHECK_THROWS_AS(MyContainer<int>::parse("[1, , 2]"), std::invalid_argument);
+        CHECK_THROWS_AS(MyContainer<int>::parse("[1, 2,]"), std::invalid_argument);
+        CHECK_THROWS_AS(MyContainer<int>::parse("[1] 2"), std::invalid_argument);
+        CHECK_THROWS_AS(MyContainer<int>::parse("1, x"), std::invalid_argument);
+        CHECK_THROWS_AS(MyContainer<int>::parse("2147483648"), std::invalid_argument);
+        CHECK_THROWS_AS(MyContainer<unsigned>::parse("-1"), std::invalid_argument);
+        CHECK_THROWS_AS(MyContainer<bool>::parse("2"), std::invalid_argument);
+        CHECK_THROWS_AS(MyContainer<double>::parse("1.5.2"), std::invalid_argument);
+        CHECK_THROWS_AS(MyContainer<double>::parse("[1e400]"), std::invalid_argument);
+        CHECK_THROWS_AS(MyContainer<double>::parse("-1e400"), std::invalid_argument);
+        CHECK_THROWS_AS(MyContainer<float>::parse("1e39"), std::invalid_argument);
+        CHECK(*MyContainer<double>::parse("[1e-320, inf]").ascending().begin() > 0.0);
+        
+        MyContainer<int> container;
+        container.add(7);
+        CHECK(*container.ascending().begin() == 7);
+        std::string bad = "8, 9, ten";
+        CHECK_THROWS_AS(container.addText(bad.data(), bad.data() + bad.size()), std::invalid_argument);
+        CHECK(inOrder(container) == std::vector<int>{7});
+        std::string good = "3\n1";
+        container.addText(good.data(), good.data() + good.size());
+        CHECK(*container.ascending().begin() == 1);
+    }
+    
+    SUBCASE("Input operator and files") {
+        std::istringstream in("  [1, 2, 3] [4]\n[5, x]");
+        MyContainer<int> container;
+        in >> container;
+        CHECK(inOrder(container) == std::vector<int>{1, 2, 3});
+        in >> container;
+        CHECK(inOrder(container) == std::vector<int>{1, 2, 3, 4});
+        in >> container;
+        CHECK(in.fail());
+        CHECK(container.size() == 4);
+        
+        std::istringstream unterminated("[1, 2");
+        unterminated >> container;
+        CHECK(unterminated.fail());
+        CHECK(container.size() == 4);
+        
+        TemporaryPath file("parsed.csv");
+        {
+            std::ofstream out(file.path);
+            out << "10\n20\n30\n";
+        }
+        CHECK(inOrder(MyContainer<int>::parseFile(file.path)) == std::vector<int>{10, 20, 30});
+        CHECK_THROWS_AS(MyContainer<int>::parseFile(file.path + ".missing"), std::system_error);
+    }
+}